@@ -0,0 +1,80 @@
+#ifndef ALIVE_BITSET_H
+#define ALIVE_BITSET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+inline int countTrailingZeros(uint64_t word) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(word);
+#endif
+}
+
+inline int popCount(uint64_t word) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return static_cast<int>(__popcnt64(word));
+#else
+    return __builtin_popcountll(word);
+#endif
+}
+
+// Флаги жизни, упакованные по 64 в слово: обход живых пропускает
+// полностью мертвые слова за одно сравнение
+class AliveBitset {
+public:
+    size_t size() const { return bits; }
+
+    void pushBack(bool value) {
+        if (bits % 64 == 0) words.push_back(0);
+        if (value) words.back() |= uint64_t(1) << (bits % 64);
+        bits++;
+    }
+
+    bool test(size_t i) const { return (words[i / 64] >> (i % 64)) & 1; }
+    void set(size_t i) { words[i / 64] |= uint64_t(1) << (i % 64); }
+    void reset(size_t i) { words[i / 64] &= ~(uint64_t(1) << (i % 64)); }
+
+    void resize(size_t count) {
+        words.resize((count + 63) / 64);
+        bits = count;
+        if (bits % 64) words.back() &= (uint64_t(1) << (bits % 64)) - 1;
+    }
+    void reserve(size_t count) { words.reserve((count + 63) / 64); }
+    void clear() {
+        words.clear();
+        bits = 0;
+    }
+
+    size_t count() const {
+        size_t total = 0;
+        for (uint64_t word : words) total += static_cast<size_t>(popCount(word));
+        return total;
+    }
+
+    // fn(i) для каждого установленного бита по возрастанию
+    template <typename Fn>
+    void forEachSet(Fn&& fn) const {
+        for (size_t w = 0; w < words.size(); ++w) {
+            for (uint64_t word = words[w]; word; word &= word - 1) {
+                fn(w * 64 + static_cast<size_t>(countTrailingZeros(word)));
+            }
+        }
+    }
+
+    const uint64_t* data() const { return words.data(); }
+
+private:
+    std::vector<uint64_t> words;  // биты за пределами size() всегда 0
+    size_t bits = 0;
+};
+
+#endif
@@ -0,0 +1,1094 @@
+#include "factory.h"
+#include "dungeon_snapshot.h"
+#include "dungeon_parser.h"
+#include "thread_pool.h"
+#include "name_table.h"
+#include "npc_arena.h"
+#include "visitor.h"
+#include "observer.h"
+#include "npc_world.h"
+#include "alive_bitset.h"
+#include "simd_kernels.h"
+#include "tiled_combat.h"
+#include "sparse_grid.h"
+#include "thread_safe_queue.h"
+#include "mpmc_ring_buffer.h"
+#include "world_frame.h"
+#include "map_renderer.h"
+#include "world_config.h"
+#include "game_engine.h"
+#include "bench_harness.h"
+#include <atomic>
+#include <thread>
+#include "game_constants.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <filesystem>
+#include <shared_mutex>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Seed отслеживаемых замеров: прогоны разных версий сравнимы между собой
+constexpr uint64_t BENCH_SEED = 42;
+
+// Глушит std::cout, пока жив: сообщения движка об убийствах не должны мерить терминал
+class SilentCout {
+public:
+    SilentCout() : saved(std::cout.rdbuf(&sink)) {}
+    ~SilentCout() { std::cout.rdbuf(saved); }
+    
+private:
+    struct NullBuffer : std::streambuf {
+        int overflow(int c) override { return c; }
+        std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+    };
+    NullBuffer sink;
+    std::streambuf* saved;
+};
+
+std::vector<std::shared_ptr<NPC>> makeDungeon(size_t count, int side, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> posDist(0, side - 1);
+    std::uniform_int_distribution<int> typeDist(0, static_cast<int>(NPC_TYPE_COUNT) - 1);
+    
+    std::vector<std::shared_ptr<NPC>> npcs;
+    npcs.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        npcs.push_back(NPCFactory::create(static_cast<NPCType>(typeDist(rng)),
+                                          posDist(rng), posDist(rng),
+                                          "NPC_" + std::to_string(i)));
+    }
+    return npcs;
+}
+
+// Среднее время одного боя в микросекундах; подземелье пересоздается на каждый прогон
+template <typename Fight>
+double timeFight(size_t count, int side, int range, int repeats, Fight fight) {
+    double total = 0;
+    for (int r = 0; r < repeats; ++r) {
+        auto npcs = makeDungeon(count, side, 42 + r);
+        Observable observable;
+        NPCVisitor visitor(range, observable);
+        
+        auto start = Clock::now();
+        fight(visitor, npcs);
+        total += std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+    return total / repeats;
+}
+
+void benchFightCrossover() {
+    const int range = 10;
+    std::cout << "=== NPCVisitor::fight: brute force vs SpatialGrid (range " << range << ") ===" << std::endl;
+    std::cout << std::setw(10) << "NPCs" << std::setw(10) << "side"
+              << std::setw(16) << "brute, us" << std::setw(16) << "grid, us" << std::endl;
+    
+    for (size_t count : {8, 16, 32, 64, 128, 256, 1024, 4096, 16384, 100000}) {
+        // Плотность как у редактора: в среднем около 1 NPC на 25 клеток
+        int side = std::max(50, static_cast<int>(std::sqrt(count * 25.0)));
+        int repeats = count < 1024 ? 200 : 3;
+        
+        double grid = timeFight(count, side, range, repeats,
+            [](NPCVisitor& v, std::vector<std::shared_ptr<NPC>>& n) { v.fightSpatial(n); });
+        std::cout << std::setw(10) << count << std::setw(10) << side;
+        if (count <= 16384) {
+            double brute = timeFight(count, side, range, repeats,
+                [](NPCVisitor& v, std::vector<std::shared_ptr<NPC>>& n) { v.fightBruteForce(n); });
+            std::cout << std::setw(16) << std::fixed << std::setprecision(1) << brute;
+        } else {
+            std::cout << std::setw(16) << "-";
+        }
+        std::cout << std::setw(16) << std::fixed << std::setprecision(1) << grid << std::endl;
+    }
+}
+
+void benchMovementSweep() {
+    const size_t count = 1000000;
+    const int ticks = 5;
+    std::cout << "\n=== Movement sweep, " << count << " NPCs, " << ticks << " ticks ===" << std::endl;
+    
+    auto npcs = makeDungeon(count, MAP_WIDTH, 1);
+    NPCWorld world;
+    world.reserve(count);
+    for (const auto& npc : npcs) {
+        world.spawn(*npc);
+    }
+    
+    std::mt19937 npcRng(9);
+    for (auto& npc : npcs) {
+        npc->setRandomEngine(npcRng);
+    }
+    auto start = Clock::now();
+    for (int t = 0; t < ticks; ++t) {
+        for (auto& npc : npcs) {
+            npc->move(MAP_WIDTH, MAP_HEIGHT);
+        }
+    }
+    double objects = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / ticks;
+    
+    std::mt19937 worldRng(9);
+    start = Clock::now();
+    for (int t = 0; t < ticks; ++t) {
+        world.moveAll(worldRng, MAP_WIDTH, MAP_HEIGHT);
+    }
+    double soa = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / ticks;
+    
+    uint32_t key = makeStreamKey(9);
+    start = Clock::now();
+    for (int t = 0; t < ticks; ++t) {
+        world.moveAllBatch(key, static_cast<uint32_t>(t), MAP_WIDTH, MAP_HEIGHT);
+    }
+    double batch = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / ticks;
+    
+    std::cout << "shared_ptr<NPC>::move: " << std::fixed << std::setprecision(2) << objects << " ms/tick" << std::endl;
+    std::cout << "NPCWorld::moveAll:     " << std::fixed << std::setprecision(2) << soa << " ms/tick" << std::endl;
+    std::cout << "NPCWorld::moveAllBatch: " << std::fixed << std::setprecision(2) << batch << " ms/tick ("
+              << simdLevelName(activeSimdLevel()) << ")" << std::endl;
+    
+    // Поздняя стадия боя: живых 5%, случайно разбросанных
+    std::mt19937 deathRng(5);
+    for (NPCHandle h = 0; h < count; ++h) {
+        if (deathRng() % 20 != 0) world.markDead(h);
+    }
+    auto timeSweep = [&]() {
+        auto sweepStart = Clock::now();
+        size_t visited = 0;
+        for (int t = 0; t < ticks; ++t) {
+            world.moveAllBatch(key, static_cast<uint32_t>(t), MAP_WIDTH, MAP_HEIGHT);
+            world.forEachAlive([&](NPCHandle) { visited++; });
+        }
+        return std::chrono::duration<double, std::milli>(Clock::now() - sweepStart).count() / ticks;
+    };
+    double sparse = timeSweep();
+    auto compactStart = Clock::now();
+    world.compact();
+    double compactMs = std::chrono::duration<double, std::milli>(Clock::now() - compactStart).count();
+    double compacted = timeSweep();
+    std::cout << "5% alive, move + forEachAlive: " << std::fixed << std::setprecision(2) << sparse
+              << " ms/tick, after compact(): " << compacted << " ms/tick (compact " << compactMs << " ms)" << std::endl;
+}
+
+void benchKernels() {
+    const size_t count = 1000000;
+    const int repeats = 20;
+    std::cout << "\n=== SIMD kernels, " << count << " elements ===" << std::endl;
+    std::cout << std::setw(10) << "level" << std::setw(16) << "inRange, us"
+              << std::setw(16) << "steps, us" << std::setw(16) << "moves, us" << std::endl;
+    
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> coord(0, MAP_WIDTH - 1);
+    std::vector<int32_t> xs(count), ys(count), dx(count), dy(count);
+    std::vector<uint8_t> mask(count);
+    AliveBitset alive;
+    for (size_t i = 0; i < count; ++i) {
+        xs[i] = coord(rng);
+        ys[i] = coord(rng);
+        alive.pushBack(true);
+    }
+    
+    auto time = [&](auto fn) {
+        auto start = Clock::now();
+        for (int r = 0; r < repeats; ++r) fn(r);
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / repeats;
+    };
+    
+    SimdLevel best = detectSimdLevel();
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE42, SimdLevel::AVX2}) {
+        if (level > best) continue;
+        setSimdLevel(level);
+        double range = time([&](int r) {
+            inRangeMask(xs.data(), ys.data(), count, r, r, KILL_DISTANCE * KILL_DISTANCE, mask.data());
+        });
+        double steps = time([&](int r) {
+            randomSteps(makeStreamKey(1), static_cast<uint32_t>(r * count), dx.data(), count, MOVE_DISTANCE);
+        });
+        randomSteps(makeStreamKey(2), 0, dy.data(), count, MOVE_DISTANCE);
+        double moves = time([&](int) {
+            applyMoves(xs.data(), ys.data(), dx.data(), dy.data(), alive.data(), count, MAP_WIDTH, MAP_HEIGHT);
+        });
+        std::cout << std::setw(10) << simdLevelName(level) << std::fixed << std::setprecision(1)
+                  << std::setw(16) << range << std::setw(16) << steps << std::setw(16) << moves << std::endl;
+    }
+    setSimdLevel(best);
+}
+
+void benchTiledCombatScaling() {
+    const size_t count = 1000000;
+    const int side = 2000;
+    std::cout << "\n=== TiledCombat scaling, " << count << " NPCs on " << side << "x" << side << " ===" << std::endl;
+    std::cout << std::setw(10) << "threads" << std::setw(16) << "ms/round" << std::setw(12) << "speedup" << std::endl;
+    
+    auto npcs = makeDungeon(count, side, 5);
+    size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> threadCounts;
+    for (size_t threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+    
+    double single = 0;
+    for (size_t threads : threadCounts) {
+        // Каждый прогон начинается с одного и того же мира
+        NPCWorld world;
+        world.reserve(count);
+        for (const auto& npc : npcs) {
+            world.spawn(*npc);
+        }
+        SparseGrid grid;
+        grid.rebuild(world.handleData(), world.xData(), world.yData(), world.aliveBits(), world.size());
+        ThreadPool pool(threads);
+        TiledCombat combat(KILL_DISTANCE);
+        
+        auto start = Clock::now();
+        auto kills = combat.resolve(world, grid, pool, makeStreamKey(1), 0);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (threads == 1) single = ms;
+        std::cout << std::setw(10) << threads << std::setw(16) << std::fixed << std::setprecision(1) << ms
+                  << std::setw(11) << std::setprecision(2) << single / ms << "x" << std::endl;
+    }
+}
+
+// Producers пишут items записей каждый, consumers потребителей их забирают
+template <typename Push, typename Pop>
+double timeQueue(size_t producers, size_t consumers, size_t items, Push push, Pop pop) {
+    std::atomic<size_t> consumed{0};
+    const size_t total = producers * items;
+    std::vector<std::thread> threads;
+    
+    auto start = Clock::now();
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            for (size_t i = 0; i < items; ++i) push(static_cast<uint32_t>(p), static_cast<uint32_t>(i));
+        });
+    }
+    for (size_t c = 0; c < consumers; ++c) {
+        threads.emplace_back([&]() {
+            while (consumed.load(std::memory_order_relaxed) < total) {
+                if (pop()) {
+                    consumed.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return total / seconds / 1e6;
+}
+
+void benchQueues() {
+    const size_t consumers = 4;
+    const size_t total = 400000;
+    std::cout << "\n=== Combat event queues, " << consumers << " consumers, Mops/s ===" << std::endl;
+    std::cout << std::setw(10) << "producers" << std::setw(26) << "ThreadSafeQueue+closure"
+              << std::setw(22) << "MPMCRingBuffer+POD" << std::endl;
+    
+    auto attacker = NPCFactory::create(NPCType::Bear, 0, 0, "A");
+    auto defender = NPCFactory::create(NPCType::Rogue, 0, 0, "D");
+    
+    for (size_t producers : {1, 4, 16}) {
+        size_t items = total / producers;
+        
+        // Как раньше в GameEngine: замыкание с парой shared_ptr на каждую задачу
+        ThreadSafeQueue queue;
+        double locked = timeQueue(producers, consumers, items,
+            [&](uint32_t, uint32_t) {
+                queue.push([a = attacker, d = defender]() { (void)a; (void)d; });
+            },
+            [&]() {
+                ThreadSafeQueue::Task task;
+                if (!queue.tryPop(task)) return false;
+                task();
+                return true;
+            });
+        
+        MPMCRingBuffer<KillRecord> ring(4096);
+        double lockFree = timeQueue(producers, consumers, items,
+            [&](uint32_t p, uint32_t i) {
+                KillRecord record{p, i, false};
+                while (!ring.tryPush(record)) std::this_thread::yield();
+            },
+            [&]() {
+                KillRecord record;
+                return ring.tryPop(record);
+            });
+        
+        std::cout << std::setw(10) << producers << std::fixed << std::setprecision(2)
+                  << std::setw(26) << locked << std::setw(22) << lockFree << std::endl;
+    }
+}
+
+void benchDungeonLoad() {
+    const size_t count = 1000000;
+    std::cout << "\n=== Dungeon load, " << count << " NPCs, ms ===" << std::endl;
+    
+    auto npcs = makeDungeon(count, 500, 7);
+    NPCFactory::saveToFile("bench_dungeon.txt", npcs);
+    NPCFactory::saveToSnapshot("bench_dungeon.bin", npcs);
+    
+    auto timeMs = [](auto fn) {
+        auto start = Clock::now();
+        fn();
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+    
+    size_t checksum = 0;
+    double text = timeMs([&]() { checksum += NPCFactory::loadFromFile("bench_dungeon.txt").size(); });
+    double binary = timeMs([&]() { checksum += NPCFactory::loadFromSnapshot("bench_dungeon.bin").size(); });
+    // Только отображение и обход записей, без создания NPC
+    double mapped = timeMs([&]() {
+        DungeonSnapshot snapshot("bench_dungeon.bin");
+        for (size_t i = 0; i < snapshot.size(); ++i) {
+            checksum += snapshot.record(i).x + snapshot.name(i).size();
+        }
+    });
+    
+    std::cout << std::fixed << std::setprecision(1)
+              << "text: " << text << ", snapshot: " << binary
+              << ", mapped scan: " << mapped << " (checksum " << checksum << ")" << std::endl;
+    std::remove("bench_dungeon.txt");
+    std::remove("bench_dungeon.bin");
+}
+
+void benchTextParser() {
+    const size_t count = 2000000;
+    std::cout << "\n=== Text parser, " << count << " lines ===" << std::endl;
+    
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> posDist(0, 500);
+    const char* types[] = {"Bear", "Werewolf", "Rogue"};
+    std::string text;
+    for (size_t i = 0; i < count; ++i) {
+        text += types[i % 3];
+        text += ' ' + std::to_string(posDist(rng)) + ' ' + std::to_string(posDist(rng)) + " NPC_" + std::to_string(i) + '\n';
+    }
+    const double megabytes = text.size() / 1e6;
+    
+    auto report = [&](const char* label, double seconds, size_t parsed) {
+        std::cout << std::setw(26) << label << std::fixed << std::setprecision(1)
+                  << std::setw(10) << seconds * 1e3 << " ms" << std::setw(10) << megabytes / seconds << " MB/s"
+                  << "  (" << parsed << ")" << std::endl;
+    };
+    
+    // Прежний путь: istringstream и std::string на каждую строку
+    {
+        auto start = Clock::now();
+        std::istringstream input(text);
+        size_t parsed = 0;
+        for (std::string line; std::getline(input, line);) {
+            std::istringstream iss(line);
+            std::string typeStr, name;
+            int x, y;
+            iss >> typeStr >> x >> y;
+            std::getline(iss >> std::ws, name);
+            parsed += name.size() > 0;
+        }
+        report("istringstream per line", std::chrono::duration<double>(Clock::now() - start).count(), parsed);
+    }
+    {
+        auto start = Clock::now();
+        ParseError error;
+        size_t line = 0;
+        size_t parsed = 0;
+        parseDungeonText(text, [&](const NPCRecord& record) { parsed += record.name.size() > 0; }, error, line);
+        report("parseDungeonText", std::chrono::duration<double>(Clock::now() - start).count(), parsed);
+    }
+    {
+        auto start = Clock::now();
+        std::vector<std::shared_ptr<NPC>> npcs;
+        npcs.reserve(count);
+        ParseError error;
+        parseDungeon(text, npcs, error);
+        report("parseDungeon + NPCs", std::chrono::duration<double>(Clock::now() - start).count(), npcs.size());
+    }
+}
+
+void benchParallelIO() {
+    const size_t count = 2000000;
+    std::cout << "\n=== Text dungeon I/O, " << count << " NPCs, ms ===" << std::endl;
+    std::cout << std::setw(10) << "threads" << std::setw(12) << "save" << std::setw(12) << "load" << std::endl;
+    
+    auto npcs = makeDungeon(count, 500, 3);
+    auto timeMs = [](auto fn) {
+        auto start = Clock::now();
+        fn();
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+    
+    size_t hw = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t threads : {size_t(1), size_t(2), size_t(4), hw}) {
+        ThreadPool pool(threads);
+        size_t loaded = 0;
+        double save = timeMs([&]() { NPCFactory::saveToFile("bench_io.txt", npcs, pool); });
+        double load = timeMs([&]() { loaded = NPCFactory::loadFromFile("bench_io.txt", pool).size(); });
+        std::cout << std::setw(10) << threads << std::fixed << std::setprecision(1)
+                  << std::setw(12) << save << std::setw(12) << load
+                  << (loaded == count ? "" : "  (size mismatch)") << std::endl;
+        if (threads == hw) break;
+    }
+    std::remove("bench_io.txt");
+}
+
+void benchNameInterning() {
+    const size_t count = 1000000;
+    std::cout << "\n=== Name interning, memory per " << count << " NPCs, MB ===" << std::endl;
+    std::cout << "sizeof(NPC) = " << sizeof(NPC) << " (name field " << sizeof(NameId)
+              << " bytes instead of " << sizeof(std::string) << ")" << std::endl;
+    std::cout << std::setw(28) << "names" << std::setw(14) << "std::string"
+              << std::setw(12) << "interned" << std::setw(10) << "saved" << std::endl;
+    
+    // Сравниваем только память под имена: поле в NPC плюс буферы вне SSO и таблица
+    auto report = [&](const char* label, auto makeName) {
+        NameTable& table = NameTable::global();
+        size_t before = table.memoryUsage();
+        size_t owned = 0;
+        for (size_t i = 0; i < count; ++i) {
+            std::string name = makeName(i);
+            owned += sizeof(std::string) + (name.size() > 15 ? name.size() + 1 : 0);
+            table.intern(name);
+        }
+        size_t interned = count * sizeof(NameId) + (table.memoryUsage() - before);
+        std::cout << std::setw(28) << label << std::fixed << std::setprecision(1)
+                  << std::setw(14) << owned / 1e6 << std::setw(12) << interned / 1e6
+                  << std::setw(10) << (double(owned) - double(interned)) / 1e6 << std::endl;
+    };
+    
+    const char* kinds[] = {"Bear", "Werewolf", "Rogue"};
+    report("unique names", [](size_t i) { return "Unique_" + std::to_string(i); });
+    report("1000 names x 1000 NPCs", [&](size_t i) {
+        return std::string(kinds[i % 3]) + " of the Northern Marches #" + std::to_string(i % 1000);
+    });
+}
+
+// Байты, удерживаемые malloc, и байты в выданных блоках (только glibc)
+std::pair<size_t, size_t> heapUsage() {
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    struct mallinfo2 info = mallinfo2();
+    return {info.arena + info.hblkhd, info.uordblks + info.hblkhd};
+#else
+    return {0, 0};
+#endif
+}
+
+void benchNPCAllocation() {
+    const size_t count = 10000000;
+    std::cout << "\n=== NPC allocation, " << count << " NPCs ===" << std::endl;
+    std::cout << std::setw(14) << "allocator" << std::setw(12) << "create ms" << std::setw(14) << "teardown ms"
+              << std::setw(14) << "held MB" << std::setw(14) << "in use MB" << std::endl;
+    
+    NameId name = NameTable::global().intern("Pooled");
+    auto timeMs = [](auto fn) {
+        auto start = Clock::now();
+        fn();
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+    // Держим/используем после "перемешивания": половина NPC умерла, на их место созданы новые
+    auto churn = [&](std::vector<std::shared_ptr<NPC>>& npcs, auto create) {
+        for (size_t i = 0; i < npcs.size(); i += 2) npcs[i].reset();
+        for (size_t i = 0; i < npcs.size(); i += 4) npcs[i] = create(i);
+    };
+    auto print = [](const char* label, double create, double teardown, double held, double used) {
+        std::cout << std::setw(14) << label << std::fixed << std::setprecision(1)
+                  << std::setw(12) << create << std::setw(14) << teardown
+                  << std::setw(14) << held / 1e6 << std::setw(14) << used / 1e6 << std::endl;
+    };
+    
+    {
+        std::vector<std::shared_ptr<NPC>> npcs;
+        npcs.reserve(count);
+        auto makeShared = [&](size_t i) { return std::shared_ptr<NPC>(std::make_shared<Rogue>(int(i % 500), 0, name)); };
+        double create = timeMs([&]() {
+            for (size_t i = 0; i < count; ++i) npcs.push_back(makeShared(i));
+        });
+        churn(npcs, makeShared);
+        auto [held, used] = heapUsage();
+        double teardown = timeMs([&]() { npcs.clear(); });
+        print("make_shared", create, teardown, double(held), double(used));
+    }
+    {
+        std::vector<std::shared_ptr<NPC>> npcs;
+        npcs.reserve(count);
+        NPCArena arena(65536);
+        auto fromArena = [&](size_t i) { return NPCFactory::create(NPCType::Rogue, int(i % 500), 0, name, arena); };
+        double create = timeMs([&]() {
+            for (size_t i = 0; i < count; ++i) npcs.push_back(fromArena(i));
+        });
+        churn(npcs, fromArena);
+        auto stats = arena.getStats();
+        double blockBytes = double(stats.reservedBytes) / double(stats.liveBlocks + stats.freeBlocks);
+        double teardown = timeMs([&]() {
+            npcs.clear();
+            arena.release();
+        });
+        print("NPCArena", create, teardown, double(stats.reservedBytes), stats.liveBlocks * blockBytes);
+    }
+}
+
+}
+
+void benchFramePublish() {
+    const size_t count = 1000000;
+    const int ticks = 20;
+    std::cout << "\n=== Frame publish, " << count << " NPCs, " << ticks << " ticks ===" << std::endl;
+    
+    auto npcs = makeDungeon(count, MAP_WIDTH, 3);
+    NPCWorld world;
+    world.reserve(count);
+    for (const auto& npc : npcs) {
+        world.spawn(*npc);
+    }
+    uint32_t key = makeStreamKey(3);
+    
+    // Читатель, как кадр карты: проходит всех живых
+    auto sumFrame = [](const WorldFrame& frame) {
+        int64_t sum = 0;
+        for (size_t i = 0; i < frame.size(); ++i) sum += frame.x[i] + frame.y[i];
+        return sum;
+    };
+    
+    // Как раньше: тик под unique_lock, читатель под shared_lock на живом мире
+    std::shared_mutex mutex;
+    std::atomic<bool> done{false};
+    std::atomic<int64_t> sink{0};
+    size_t lockedReads = 0;
+    std::thread lockedReader([&]() {
+        while (!done) {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            int64_t sum = 0;
+            world.forEachAlive([&](NPCHandle h) { sum += world.getX(h) + world.getY(h); });
+            sink += sum;
+            lockedReads++;
+        }
+    });
+    double lockedMax = 0;
+    auto start = Clock::now();
+    for (int t = 0; t < ticks; ++t) {
+        auto tickStart = Clock::now();
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        world.moveAllBatch(key, static_cast<uint32_t>(t), MAP_WIDTH, MAP_HEIGHT);
+        lockedMax = std::max(lockedMax, std::chrono::duration<double, std::milli>(Clock::now() - tickStart).count());
+    }
+    double locked = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / ticks;
+    done = true;
+    lockedReader.join();
+    
+    // Цена публикации без читателей: оба буфера уже прогреты
+    FramePublisher frames;
+    for (int t = 0; t < 2; ++t) {
+        frames.acquire().capture(world, 0);
+        frames.publish();
+    }
+    start = Clock::now();
+    for (int t = 0; t < ticks; ++t) {
+        frames.acquire().capture(world, 0);
+        frames.publish();
+    }
+    double publishAlone = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / ticks;
+    
+    // Двойной буфер: тик пишет мир и публикует кадр, читатель берет кадр
+    done = false;
+    size_t frameReads = 0;
+    std::thread frameReader([&]() {
+        while (!done) {
+            sink += sumFrame(*frames.current());
+            frameReads++;
+        }
+    });
+    double frameMax = 0;
+    double publishTotal = 0;
+    start = Clock::now();
+    for (int t = 0; t < ticks; ++t) {
+        auto tickStart = Clock::now();
+        world.moveAllBatch(key, static_cast<uint32_t>(t), MAP_WIDTH, MAP_HEIGHT);
+        auto publishStart = Clock::now();
+        frames.acquire().capture(world, static_cast<uint32_t>(t + 1));
+        frames.publish();
+        auto tickEnd = Clock::now();
+        publishTotal += std::chrono::duration<double, std::milli>(tickEnd - publishStart).count();
+        frameMax = std::max(frameMax, std::chrono::duration<double, std::milli>(tickEnd - tickStart).count());
+    }
+    double published = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / ticks;
+    done = true;
+    frameReader.join();
+    
+    std::cout << "shared_mutex:   " << std::fixed << std::setprecision(2) << locked << " ms/tick, max "
+              << lockedMax << " ms, " << lockedReads << " reads" << std::endl;
+    std::cout << "capture+publish alone: " << std::fixed << std::setprecision(2) << publishAlone
+              << " ms/tick" << std::endl;
+    std::cout << "FramePublisher: " << std::fixed << std::setprecision(2) << published << " ms/tick, max "
+              << frameMax << " ms (publish " << publishTotal / ticks << " ms), " << frameReads
+              << " reads, " << frames.reallocations() << " buffer reallocations" << std::endl;
+}
+
+void benchMapRender() {
+    const int frames = 50;
+    std::cout << "\n=== Map render, " << MAP_WIDTH << "x" << MAP_HEIGHT << ", " << frames << " frames ===" << std::endl;
+    
+    auto npcs = makeDungeon(INITIAL_NPC_COUNT, MAP_WIDTH, 4);
+    NPCWorld world;
+    for (const auto& npc : npcs) {
+        world.spawn(*npc);
+    }
+    WorldFrame frame;
+    uint32_t key = makeStreamKey(4);
+    
+    // Как раньше: вектор строк и operator<< по символу с std::endl на строку
+    std::ostringstream sink;
+    auto start = Clock::now();
+    for (int f = 0; f < frames; ++f) {
+        world.moveAllBatch(key, static_cast<uint32_t>(f), MAP_WIDTH, MAP_HEIGHT);
+        frame.capture(world, static_cast<uint32_t>(f));
+        std::vector<std::vector<char>> map(MAP_HEIGHT, std::vector<char>(MAP_WIDTH, '.'));
+        for (size_t i = 0; i < frame.size(); ++i) {
+            map[frame.y[i]][frame.x[i]] = "BWR"[static_cast<int>(frame.type[i])];
+        }
+        sink.str("");
+        for (int y = 0; y < MAP_HEIGHT; ++y) {
+            for (int x = 0; x < MAP_WIDTH; ++x) {
+                sink << map[y][x];
+            }
+            sink << std::endl;
+        }
+    }
+    double streamed = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frames;
+    
+    auto timeRenderer = [&](RenderMode mode, size_t& bytes) {
+        MapRenderer renderer(MAP_WIDTH, MAP_HEIGHT, MAP_VIEW_MAX_WIDTH, MAP_VIEW_MAX_HEIGHT, mode);
+        bytes = 0;
+        auto rendererStart = Clock::now();
+        for (int f = 0; f < frames; ++f) {
+            world.moveAllBatch(key, static_cast<uint32_t>(f), MAP_WIDTH, MAP_HEIGHT);
+            frame.capture(world, static_cast<uint32_t>(f));
+            bytes += renderer.render(frame).size();
+        }
+        return std::chrono::duration<double, std::milli>(Clock::now() - rendererStart).count() / frames;
+    };
+    size_t plainBytes = 0;
+    size_t ansiBytes = 0;
+    double plain = timeRenderer(RenderMode::Plain, plainBytes);
+    double ansi = timeRenderer(RenderMode::Ansi, ansiBytes);
+    
+    // Большая карта в окне 100x50
+    const int bigSide = 10000;
+    auto bigNpcs = makeDungeon(1000000, bigSide, 5);
+    NPCWorld bigWorld;
+    bigWorld.reserve(bigNpcs.size());
+    for (const auto& npc : bigNpcs) {
+        bigWorld.spawn(*npc);
+    }
+    WorldFrame bigFrame;
+    bigFrame.capture(bigWorld, 0);
+    MapRenderer viewport(bigSide, bigSide, 100, 50);
+    viewport.render(bigFrame);
+    
+    std::cout << "operator<< per char: " << std::fixed << std::setprecision(3) << streamed << " ms/frame" << std::endl;
+    std::cout << "MapRenderer Plain:   " << std::fixed << std::setprecision(3) << plain << " ms/frame, "
+              << plainBytes / frames << " bytes/frame" << std::endl;
+    std::cout << "MapRenderer Ansi:    " << std::fixed << std::setprecision(3) << ansi << " ms/frame, "
+              << ansiBytes / frames << " bytes/frame" << std::endl;
+    std::cout << "Viewport " << bigSide << "x" << bigSide << " -> " << viewport.viewWidth() << "x"
+              << viewport.viewHeight() << ", 1M NPCs: " << std::fixed << std::setprecision(3)
+              << viewport.lastRenderMs() << " ms" << std::endl;
+}
+
+void benchWorldScale() {
+    std::cout << "\n=== World scale ===" << std::endl;
+    
+    // Перестройка разреженной сетки занятости на умеренной и огромной карте
+    const size_t count = 1000000;
+    const int ticks = 5;
+    for (int width : {4096, 100000}) {
+        auto npcs = makeDungeon(count, width, 6);
+        NPCWorld world;
+        world.reserve(count);
+        for (const auto& npc : npcs) {
+            world.spawn(*npc);
+        }
+        uint32_t key = makeStreamKey(6);
+        auto timeTicks = [&](auto update) {
+            double total = 0;
+            for (int t = 0; t < ticks; ++t) {
+                world.moveAllBatch(key, static_cast<uint32_t>(t), width, width);
+                auto start = Clock::now();
+                update();
+                total += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            }
+            return total / ticks;
+        };
+        
+        SparseGrid sparse;
+        double ms = timeTicks([&]() {
+            sparse.rebuild(world.handleData(), world.xData(), world.yData(), world.aliveBits(), world.size());
+        });
+        std::cout << "SparseGrid " << width << "x" << width << ", " << count << " NPCs: " << std::fixed
+                  << std::setprecision(2) << ms << " ms/tick, " << sparse.chunkCount() << " chunks, "
+                  << sparse.memoryUsage() / (1024 * 1024) << " MiB" << std::endl;
+    }
+    
+    // Движок на карте 10000x10000 с миллионом NPC
+    WorldConfig config;
+    config.mapWidth = 10000;
+    config.mapHeight = 10000;
+    config.npcCount = 1000000;
+    auto start = Clock::now();
+    StepStats stats;
+    double setup;
+    size_t heap;
+    {
+        SilentCout quiet;
+        GameEngine engine(config, 7);
+        setup = std::chrono::duration<double>(Clock::now() - start).count();
+        stats = engine.step(3);
+        engine.stop();
+        heap = heapUsage().second;
+    }
+    std::cout << "GameEngine 10000x10000, 1M NPCs: setup " << std::fixed << std::setprecision(2) << setup
+              << " s, " << stats.seconds / stats.ticks * 1000.0 << " ms/tick, " << stats.survivors
+              << " survivors, heap " << heap / (1024 * 1024) << " MiB" << std::endl;
+}
+
+class CountingKillObserver : public Observer {
+public:
+    void onKill(const std::string& killer, const std::string& victim) override {
+        bytes += killer.size() + victim.size();
+    }
+    size_t bytes = 0;
+};
+
+class CountingBatchObserver : public Observer {
+public:
+    void onKills(Span<const KillEvent> kills) override {
+        for (const KillEvent& kill : kills) {
+            count += kill.mutual ? 2 : 1;
+        }
+    }
+    size_t count = 0;
+};
+
+void benchEventBus() {
+    const uint32_t ticks = 1000;
+    const uint32_t killsPerTick = 1000;
+    std::cout << "\n=== Kill events, " << ticks << " ticks x " << killsPerTick << " kills, ns/kill ===" << std::endl;
+    
+    std::vector<NameId> names(2 * killsPerTick);
+    for (size_t i = 0; i < names.size(); ++i) {
+        names[i] = NameTable::global().intern("NPC_" + std::to_string(i));
+    }
+    const NameTable& table = NameTable::global();
+    auto nsPerKill = [&](auto fn) {
+        auto start = Clock::now();
+        fn();
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (ticks * killsPerTick);
+    };
+    
+    size_t checksum = 0;
+    for (bool batched : {false, true}) {
+        Observable bus;
+        auto adapted = std::make_shared<CountingKillObserver>();
+        bus.addObserver(adapted);
+        std::shared_ptr<CountingBatchObserver> counter;
+        if (batched) {
+            counter = std::make_shared<CountingBatchObserver>();
+            bus.addObserver(counter);
+        }
+        
+        // Прежний путь: виртуальный вызов на каждое убийство с парой строк
+        double immediate = nsPerKill([&]() {
+            for (uint32_t t = 0; t < ticks; ++t) {
+                for (uint32_t k = 0; k < killsPerTick; ++k) {
+                    bus.notifyKill(table.resolve(names[2 * k]), table.resolve(names[2 * k + 1]));
+                }
+            }
+        });
+        // Шина: POD-записи в буфер потока, доставка пачкой в конце тика
+        double buffered = nsPerKill([&]() {
+            for (uint32_t t = 0; t < ticks; ++t) {
+                EventWriter out = bus.writer();
+                for (uint32_t k = 0; k < killsPerTick; ++k) {
+                    out.kill({t, 2 * k, 2 * k + 1, names[2 * k], names[2 * k + 1], false});
+                }
+            }
+        });
+        bus.flush();  // записанное выше не должно попасть в замер доставки
+        double delivered = nsPerKill([&]() {
+            for (uint32_t t = 0; t < ticks; ++t) {
+                {
+                    EventWriter out = bus.writer();
+                    for (uint32_t k = 0; k < killsPerTick; ++k) {
+                        out.kill({t, 2 * k, 2 * k + 1, names[2 * k], names[2 * k + 1], false});
+                    }
+                }
+                bus.flush();
+            }
+        });
+        checksum += adapted->bytes + (counter ? counter->count : 0);
+        
+        std::cout << (batched ? "onKill + onKills observers" : "onKill observer only      ")
+                  << std::fixed << std::setprecision(1) << ": notifyKill " << immediate
+                  << ", record " << buffered << ", record + flush per tick " << delivered << std::endl;
+    }
+    
+    // Бой в редакторе: раньше шина и наблюдатели (с файлом и потоком записи)
+    // создавались на каждый бой
+    const int battles = 200;
+    auto battleMs = [&](bool persistent) {
+        Observable shared;
+        auto sharedLog = std::make_shared<FileObserver>("bench_battle_log.txt");
+        shared.addObserver(sharedLog);
+        auto start = Clock::now();
+        for (int b = 0; b < battles; ++b) {
+            auto npcs = makeDungeon(8, 20, b);
+            if (persistent) {
+                NPCVisitor(KILL_DISTANCE, shared).fight(npcs);
+                sharedLog->flush();
+            } else {
+                Observable observable;
+                observable.addObserver(std::make_shared<FileObserver>("bench_battle_log.txt"));
+                NPCVisitor(KILL_DISTANCE, observable).fight(npcs);
+            }
+        }
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / battles;
+    };
+    double perBattle = battleMs(false);
+    double persistentBattle = battleMs(true);
+    std::remove("bench_battle_log.txt");
+    std::cout << "Editor battle, 8 NPCs: observers per battle " << std::setprecision(3) << perBattle
+              << " ms, persistent bus " << persistentBattle << " ms (checksum " << checksum << ")" << std::endl;
+}
+
+// Отслеживаемые замеры горячих путей: имя, seed и число повторов постоянны
+
+void suiteFight(BenchSuite& suite) {
+    const int range = 10;
+    for (size_t count : {1000, 10000, 100000, 1000000}) {
+        int side = std::max(50, static_cast<int>(std::sqrt(count * 25.0)));
+        int repetitions = count <= 10000 ? 10 : (count <= 100000 ? 3 : 1);
+        int rep = 0;
+        suite.measure("fight/" + std::to_string(count), BENCH_SEED, repetitions, static_cast<double>(count),
+            [&](BenchTimer& timer) {
+                timer.pause();
+                auto npcs = makeDungeon(count, side, static_cast<unsigned>(BENCH_SEED) + rep++);
+                Observable observable;
+                NPCVisitor visitor(range, observable);
+                timer.resume();
+                visitor.fight(npcs);
+                timer.pause();
+            }, "npcs");
+    }
+}
+
+void suiteEngine(BenchSuite& suite) {
+    struct Case {
+        const char* name;
+        int side;
+        int npcs;
+        uint32_t ticks;
+        int repetitions;
+    };
+    for (const Case& c : {Case{"engine/default", MAP_WIDTH, INITIAL_NPC_COUNT, 500, 5},
+                          Case{"engine/2000x2000-100k", 2000, 100000, 10, 3}}) {
+        WorldConfig config;
+        config.mapWidth = c.side;
+        config.mapHeight = c.side;
+        config.npcCount = c.npcs;
+        suite.measure(c.name, BENCH_SEED, c.repetitions, c.ticks, [&](BenchTimer& timer) {
+            timer.pause();
+            SilentCout quiet;
+            GameEngine engine(config, BENCH_SEED);
+            timer.resume();
+            engine.step(c.ticks);
+            timer.pause();
+            engine.stop();
+        }, "ticks");
+    }
+}
+
+void suiteQueues(BenchSuite& suite) {
+    const size_t consumers = 4;
+    const size_t total = 400000;
+    for (size_t producers : {1, 4, 16}) {
+        const size_t items = total / producers;
+        const std::string shape = std::to_string(producers) + "p" + std::to_string(consumers) + "c";
+        suite.measure("queue/ThreadSafeQueue/" + shape, BENCH_SEED, 3, static_cast<double>(items * producers),
+            [&](BenchTimer&) {
+                ThreadSafeQueue queue;
+                timeQueue(producers, consumers, items,
+                    [&](uint32_t, uint32_t) { queue.push([]() {}); },
+                    [&]() {
+                        ThreadSafeQueue::Task task;
+                        if (!queue.tryPop(task)) return false;
+                        task();
+                        return true;
+                    });
+            }, "ops");
+        suite.measure("queue/MPMCRingBuffer/" + shape, BENCH_SEED, 3, static_cast<double>(items * producers),
+            [&](BenchTimer&) {
+                MPMCRingBuffer<KillRecord> ring(4096);
+                timeQueue(producers, consumers, items,
+                    [&](uint32_t p, uint32_t i) {
+                        while (!ring.tryPush(KillRecord{p, i, false})) std::this_thread::yield();
+                    },
+                    [&]() {
+                        KillRecord record;
+                        return ring.tryPop(record);
+                    });
+            }, "ops");
+    }
+}
+
+void suiteDungeonIO(BenchSuite& suite) {
+    const size_t count = 1000000;
+    const std::string path = "bench_suite_dungeon.txt";
+    std::vector<std::shared_ptr<NPC>> npcs;
+    auto ensureDungeon = [&]() {
+        if (npcs.empty()) {
+            npcs = makeDungeon(count, 500, static_cast<unsigned>(BENCH_SEED));
+            NPCFactory::saveToFile(path, npcs);
+        }
+    };
+    auto addThroughput = [&](BenchResult* result) {
+        if (!result) return;
+        double mib = static_cast<double>(std::filesystem::file_size(path)) / (1024 * 1024);
+        result->counters.emplace_back("mib_per_second", mib / (result->meanMs / 1000.0));
+    };
+    
+    addThroughput(suite.measure("io/saveToFile/1M", BENCH_SEED, 3, count, [&](BenchTimer& timer) {
+        timer.pause();
+        ensureDungeon();
+        timer.resume();
+        NPCFactory::saveToFile(path, npcs);
+    }, "npcs"));
+    addThroughput(suite.measure("io/loadFromFile/1M", BENCH_SEED, 3, count, [&](BenchTimer& timer) {
+        timer.pause();
+        ensureDungeon();
+        timer.resume();
+        auto loaded = NPCFactory::loadFromFile(path);
+        timer.pause();
+        if (loaded.size() != count) {
+            throw std::runtime_error("Dungeon round trip lost NPCs");
+        }
+    }, "npcs"));
+    std::remove(path.c_str());
+    
+    // Масштабирование разбора по числу потоков. Имена уникальны и новы в
+    // каждом повторе: иначе они уже в NameTable и интернирование бесплатно
+    const size_t parseCount = 200000;
+    size_t hw = std::max(1u, std::thread::hardware_concurrency());
+    int round = 0;
+    for (size_t threads : {size_t(1), size_t(2), size_t(4), hw}) {
+        ThreadPool pool(threads);
+        suite.measure("io/parseDungeonParallel/" + std::to_string(threads) + "t", BENCH_SEED, 3,
+                      static_cast<double>(parseCount), [&](BenchTimer& timer) {
+            timer.pause();
+            std::mt19937 rng(static_cast<unsigned>(BENCH_SEED));
+            std::uniform_int_distribution<int> pos(0, 499);
+            std::string text;
+            text.reserve(parseCount * 32);
+            const std::string prefix = "Parse" + std::to_string(round++) + "_";
+            for (size_t i = 0; i < parseCount; ++i) {
+                text += npcTypeToken(static_cast<NPCType>(i % NPC_TYPE_COUNT));
+                text += ' ' + std::to_string(pos(rng)) + ' ' + std::to_string(pos(rng)) + ' ';
+                text += prefix + std::to_string(i) + '\n';
+            }
+            std::vector<std::shared_ptr<NPC>> npcs;
+            ParseError error;
+            timer.resume();
+            bool ok = parseDungeonParallel(text, npcs, error, pool, 1);
+            timer.pause();
+            if (!ok || npcs.size() != parseCount) {
+                throw std::runtime_error("Parallel parse lost NPCs");
+            }
+        }, "npcs");
+        if (threads == hw) break;
+    }
+}
+
+void suiteRender(BenchSuite& suite) {
+    const int frames = 50;
+    for (RenderMode mode : {RenderMode::Plain, RenderMode::Ansi}) {
+        const char* name = mode == RenderMode::Plain ? "render/plain-100x100" : "render/ansi-100x100";
+        suite.measure(name, BENCH_SEED, 5, frames, [&](BenchTimer& timer) {
+            timer.pause();
+            NPCWorld world;
+            for (const auto& npc : makeDungeon(INITIAL_NPC_COUNT, MAP_WIDTH, static_cast<unsigned>(BENCH_SEED))) {
+                world.spawn(*npc);
+            }
+            MapRenderer renderer(MAP_WIDTH, MAP_HEIGHT, MAP_VIEW_MAX_WIDTH, MAP_VIEW_MAX_HEIGHT, mode);
+            WorldFrame frame;
+            uint32_t key = makeStreamKey(BENCH_SEED);
+            timer.resume();
+            for (int f = 0; f < frames; ++f) {
+                world.moveAllBatch(key, static_cast<uint32_t>(f), MAP_WIDTH, MAP_HEIGHT);
+                frame.capture(world, static_cast<uint32_t>(f));
+                renderer.render(frame);
+            }
+        }, "frames");
+    }
+    
+    // Уменьшение карты 10000x10000 с миллионом NPC в окно по умолчанию
+    const int side = 10000;
+    NPCWorld bigWorld;
+    WorldFrame bigFrame;
+    suite.measure("render/viewport-10000x10000-1M", BENCH_SEED, 5, 1, [&](BenchTimer& timer) {
+        timer.pause();
+        if (bigWorld.size() == 0) {
+            auto npcs = makeDungeon(1000000, side, static_cast<unsigned>(BENCH_SEED));
+            bigWorld.reserve(npcs.size());
+            for (const auto& npc : npcs) {
+                bigWorld.spawn(*npc);
+            }
+            bigFrame.capture(bigWorld, 0);
+        }
+        MapRenderer renderer(side, side);
+        timer.resume();
+        renderer.render(bigFrame);
+    }, "frames");
+}
+
+int main(int argc, char** argv) {
+    try {
+        BenchSuite suite(argc, argv);
+        
+        suiteFight(suite);
+        suiteEngine(suite);
+        suiteQueues(suite);
+        suiteDungeonIO(suite);
+        suiteRender(suite);
+        
+        // Сравнительные таблицы; в JSON не попадают
+        suite.table("table/fight-crossover", benchFightCrossover);
+        suite.table("table/movement", benchMovementSweep);
+        suite.table("table/frame-publish", benchFramePublish);
+        suite.table("table/map-render", benchMapRender);
+        suite.table("table/world-scale", benchWorldScale);
+        suite.table("table/kernels", benchKernels);
+        suite.table("table/tiled-combat", benchTiledCombatScaling);
+        suite.table("table/queues", benchQueues);
+        suite.table("table/event-bus", benchEventBus);
+        suite.table("table/dungeon-load", benchDungeonLoad);
+        suite.table("table/text-parser", benchTextParser);
+        suite.table("table/parallel-io", benchParallelIO);
+        suite.table("table/name-interning", benchNameInterning);
+        suite.table("table/npc-allocation", benchNPCAllocation);
+        
+        suite.finish();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
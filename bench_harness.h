@@ -0,0 +1,220 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Небольшая замена Google Benchmark для rpg_bench: именованные замеры с
+// повторами и фиксированным seed, отбор по имени и отчет JSON, который
+// можно сравнивать между версиями. Замер - один вызов функции на повтор;
+// подготовку внутри повтора исключают из времени через pause/resume.
+//
+// Аргументы: --filter=a,b (подстроки имени), --repetitions=N,
+// --json=файл ("-" - в stdout), --list.
+
+// Время одного повтора; идет с начала вызова функции замера
+class BenchTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void pause() {
+        if (!running) return;
+        elapsed += Clock::now() - started;
+        running = false;
+    }
+    void resume() {
+        if (running) return;
+        started = Clock::now();
+        running = true;
+    }
+
+private:
+    friend class BenchSuite;
+
+    void start() {
+        elapsed = Clock::duration::zero();
+        running = false;
+        resume();
+    }
+    double stopMs() {
+        pause();
+        return std::chrono::duration<double, std::milli>(elapsed).count();
+    }
+
+    Clock::time_point started;
+    Clock::duration elapsed{};
+    bool running = false;
+};
+
+struct BenchResult {
+    std::string name;
+    uint64_t seed = 0;
+    int repetitions = 0;
+    double meanMs = 0;
+    double minMs = 0;
+    double maxMs = 0;
+    double stddevMs = 0;
+    // <unit>_per_second и счетчики, добавленные замером
+    std::vector<std::pair<std::string, double>> counters;
+};
+
+class BenchSuite {
+public:
+    BenchSuite(int argc, char** argv) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg.rfind("--filter=", 0) == 0) {
+                std::stringstream list(arg.substr(9));
+                std::string part;
+                while (std::getline(list, part, ',')) {
+                    if (!part.empty()) filters.push_back(part);
+                }
+            } else if (arg.rfind("--json=", 0) == 0) {
+                jsonPath = arg.substr(7);
+            } else if (arg.rfind("--repetitions=", 0) == 0) {
+                repetitionsOverride = std::max(1, std::atoi(arg.c_str() + 14));
+            } else if (arg == "--list") {
+                listing = true;
+            } else {
+                throw std::runtime_error("Unknown argument: " + arg +
+                                         " (expected --filter=, --json=, --repetitions=, --list)");
+            }
+        }
+    }
+
+    bool selected(const std::string& name) const {
+        if (filters.empty()) return true;
+        return std::any_of(filters.begin(), filters.end(),
+                           [&](const std::string& f) { return name.find(f) != std::string::npos; });
+    }
+
+    // Обзорная таблица для чтения глазами; в JSON не попадает
+    template <typename Fn>
+    void table(const std::string& name, Fn fn) {
+        if (!selected(name)) return;
+        if (listing) {
+            std::cout << name << std::endl;
+            return;
+        }
+        fn();
+    }
+
+    // fn(BenchTimer&) на каждый повтор; items - обработанных за повтор единиц
+    // unit (счетчик <unit>_per_second). Результат действителен до следующего
+    // measure; nullptr, если замер не выбран
+    template <typename Fn>
+    BenchResult* measure(const std::string& name, uint64_t seed, int repetitions, double items, Fn fn,
+                         const std::string& unit = "items") {
+        if (!selected(name)) return nullptr;
+        if (listing) {
+            std::cout << name << std::endl;
+            return nullptr;
+        }
+        if (repetitionsOverride > 0) repetitions = repetitionsOverride;
+
+        std::vector<double> times;
+        BenchTimer timer;
+        for (int r = 0; r < repetitions; ++r) {
+            timer.start();
+            fn(timer);
+            times.push_back(timer.stopMs());
+        }
+
+        BenchResult result;
+        result.name = name;
+        result.seed = seed;
+        result.repetitions = repetitions;
+        result.minMs = *std::min_element(times.begin(), times.end());
+        result.maxMs = *std::max_element(times.begin(), times.end());
+        double sum = 0;
+        for (double t : times) sum += t;
+        result.meanMs = sum / times.size();
+        double squares = 0;
+        for (double t : times) squares += (t - result.meanMs) * (t - result.meanMs);
+        result.stddevMs = times.size() > 1 ? std::sqrt(squares / (times.size() - 1)) : 0.0;
+        if (items > 0 && result.meanMs > 0) {
+            result.counters.emplace_back(unit + "_per_second", items / (result.meanMs / 1000.0));
+        }
+        results.push_back(result);
+
+        std::cout << std::left << std::setw(36) << name << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(12) << result.meanMs << " ms" << std::setw(12) << result.minMs
+                  << " min" << std::setw(12) << result.maxMs << " max";
+        if (items > 0) {
+            std::cout << std::setprecision(0) << std::setw(14) << items / (result.meanMs / 1000.0) << " " << unit << "/s";
+        }
+        std::cout << std::endl;
+        return &results.back();
+    }
+
+    // Пишет JSON, если задан --json; вызывается в конце main
+    void finish() const {
+        if (jsonPath.empty() || listing) return;
+        if (jsonPath == "-") {
+            writeJson(std::cout);
+            return;
+        }
+        std::ofstream file(jsonPath);
+        if (!file) {
+            throw std::runtime_error("Cannot write benchmark report: " + jsonPath);
+        }
+        writeJson(file);
+        std::cout << "JSON report: " << jsonPath << std::endl;
+    }
+
+private:
+    static std::string quoted(const std::string& text) {
+        std::string out = "\"";
+        for (char c : text) {
+            if (c == '"' || c == '\\') out += '\\';
+            out += c;
+        }
+        return out + "\"";
+    }
+
+    void writeJson(std::ostream& out) const {
+        out << "{\n  \"context\": {\n";
+#if defined(__VERSION__)
+        out << "    \"compiler\": " << quoted(__VERSION__) << ",\n";
+#endif
+#ifdef RPG_BUILD_TYPE
+        out << "    \"build_type\": " << quoted(RPG_BUILD_TYPE) << ",\n";
+#endif
+        out << "    \"hardware_concurrency\": " << std::thread::hardware_concurrency() << "\n  },\n";
+        out << "  \"benchmarks\": [";
+        out << std::defaultfloat << std::setprecision(6);
+        for (size_t i = 0; i < results.size(); ++i) {
+            const BenchResult& r = results[i];
+            out << (i ? ",\n" : "\n") << "    {\"name\": " << quoted(r.name) << ", \"seed\": " << r.seed
+                << ", \"repetitions\": " << r.repetitions << ", \"time_unit\": \"ms\""
+                << ", \"mean\": " << r.meanMs << ", \"min\": " << r.minMs << ", \"max\": " << r.maxMs
+                << ", \"stddev\": " << r.stddevMs;
+            for (const auto& counter : r.counters) {
+                out << ", " << quoted(counter.first) << ": " << counter.second;
+            }
+            out << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    std::vector<std::string> filters;
+    std::string jsonPath;
+    int repetitionsOverride = 0;
+    bool listing = false;
+    std::vector<BenchResult> results;
+};
+
+#endif
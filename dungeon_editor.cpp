@@ -1,27 +1,49 @@
 #include "dungeon_editor.h"
+#include "dungeon_snapshot.h"
 #include "factory.h"
 #include "visitor.h"
 #include "observer.h"
+#include <algorithm>
+#include <filesystem>
 #include <iostream>
 
-void DungeonEditor::addNPC(NPCType type, int x, int y, const std::string& name) {
-    if (x < 0 || x > 500 || y < 0 || y > 500) {
-        throw std::runtime_error("Coordinates out of bounds (0-500)");
+DungeonEditor::DungeonEditor() : DungeonEditor(WorldConfig::editorDefaults()) {
+}
+
+DungeonEditor::DungeonEditor(const WorldConfig& config) : config(config) {
+    this->config.validate();
+}
+
+void DungeonEditor::checkBounds(int x, int y) const {
+    if (!config.contains(x, y)) {
+        throw std::runtime_error("Coordinates out of bounds (0-" + std::to_string(config.mapWidth - 1) +
+                                 ", 0-" + std::to_string(config.mapHeight - 1) + ")");
     }
+}
+
+void DungeonEditor::addNPC(NPCType type, int x, int y, const std::string& name) {
+    checkBounds(x, y);
     npcs.push_back(NPCFactory::create(type, x, y, name));
 }
 
+void DungeonEditor::moveNPC(size_t index, int x, int y) {
+    if (index >= npcs.size()) {
+        throw std::runtime_error("NPC index out of range");
+    }
+    checkBounds(x, y);
+    NPC& npc = *npcs[index];
+    if (!npc.isAlive()) {
+        throw std::runtime_error("Cannot move dead NPC: " + npc.getName());
+    }
+    npc.setPosition(x, y);
+    dirty.push_back(index);
+}
+
 void DungeonEditor::printAll() const {
     std::cout << "NPCs in dungeon:" << std::endl;
     for (const auto& npc : npcs) {
         if (npc->isAlive()) {
-            std::string typeStr;
-            switch (npc->getType()) {
-                case NPCType::Bear: typeStr = "Bear"; break;
-                case NPCType::Werewolf: typeStr = "Werewolf"; break;  // Изменено
-                case NPCType::Rogue: typeStr = "Rogue"; break;
-            }
-            std::cout << typeStr << " '" << npc->getName() << "' at (" 
+            std::cout << npcTypeToken(npc->getType()) << " '" << npc->getName() << "' at (" 
                       << npc->getX() << ", " << npc->getY() << ")" << std::endl;
         }
     }
@@ -31,20 +53,142 @@ void DungeonEditor::save(const std::string& filename) const {
     NPCFactory::saveToFile(filename, npcs);
 }
 
+void DungeonEditor::saveSnapshot(const std::string& filename) {
+    NPCFactory::saveToSnapshot(filename, npcs);
+    // Записи нового файла не совпадают с индексами редактора: база отцепляется
+    if (!journalPath.empty() && filename == journalPath) {
+        resetJournal("", 0);
+    }
+}
+
 void DungeonEditor::load(const std::string& filename) {
-    npcs = NPCFactory::loadFromFile(filename);
+    std::vector<std::shared_ptr<NPC>> loaded;
+    uint64_t end = 0;
+    bool snapshotFormat = DungeonSnapshot::isSnapshot(filename);
+    if (snapshotFormat) {
+        DungeonSnapshot snapshot(filename);
+        loaded = NPCFactory::loadFromSnapshot(snapshot);
+        end = snapshot.journalEnd();
+    } else {
+        loaded = NPCFactory::loadFromFile(filename);
+    }
+    
+    // Проверяем до замены: при ошибке редактор остается с прежними NPC
+    for (const auto& npc : loaded) {
+        if (!config.contains(npc->getX(), npc->getY())) {
+            throw std::runtime_error("NPC '" + npc->getName() + "' at (" + std::to_string(npc->getX()) + ", " +
+                                     std::to_string(npc->getY()) + ") is outside the " +
+                                     std::to_string(config.mapWidth) + "x" + std::to_string(config.mapHeight) +
+                                     " map: " + filename);
+        }
+    }
+    npcs = std::move(loaded);
+    resetJournal(snapshotFormat ? filename : "", end);
 }
 
-void DungeonEditor::battle(int range) {
-    Observable observable;
-    auto consoleObserver = std::make_shared<ConsoleObserver>();
-    auto fileObserver = std::make_shared<FileObserver>();
+void DungeonEditor::compact(const std::string& filename) {
+    npcs.erase(std::remove_if(npcs.begin(), npcs.end(),
+                              [](const std::shared_ptr<NPC>& npc) { return !npc->isAlive(); }),
+               npcs.end());
+    
+    // Через временный файл: при сбое старый снимок с журналом остается целым
+    const std::string temp = filename + ".tmp";
+    NPCFactory::saveToSnapshot(temp, npcs);
+    std::filesystem::rename(temp, filename);
+    resetJournal(filename, std::filesystem::file_size(filename));
+}
+
+void DungeonEditor::saveDelta() {
+    if (journalPath.empty()) {
+        throw std::runtime_error("No base snapshot for delta save: call compact() first");
+    }
+    
+    std::string entries;
+    auto append = [&](JournalOp op, size_t index, const NPC& npc, std::string_view name = {}) {
+        DungeonSnapshot::checkLimits(index + 1, 0);  // индекс в журнале тоже 32-битный
+        JournalEntry entry{};
+        entry.op = static_cast<uint8_t>(op);
+        entry.type = static_cast<uint8_t>(npc.getType());
+        entry.nameLength = static_cast<uint16_t>(name.size());
+        entry.index = static_cast<uint32_t>(index);
+        entry.x = npc.getX();
+        entry.y = npc.getY();
+        DungeonSnapshot::encodeJournalEntry(entries, entry, name);
+    };
     
-    observable.addObserver(consoleObserver);
-    observable.addObserver(fileObserver);
+    for (size_t index : dirty) {
+        if (index >= saved.size()) continue;  // новые NPC пишутся ниже целиком
+        const NPC& npc = *npcs[index];
+        SavedState& state = saved[index];
+        if (npc.getX() != state.x || npc.getY() != state.y) {
+            append(JournalOp::Move, index, npc);
+        }
+        if (!npc.isAlive() && state.alive) {
+            append(JournalOp::Kill, index, npc);
+        }
+        state = {npc.getX(), npc.getY(), npc.isAlive()};
+    }
+    for (size_t index = saved.size(); index < npcs.size(); ++index) {
+        const NPC& npc = *npcs[index];
+        if (npc.getName().size() > UINT16_MAX) {
+            throw std::runtime_error("NPC name too long for snapshot: " + npc.getName().substr(0, 32));
+        }
+        append(JournalOp::Add, index, npc, npc.getName());
+        if (!npc.isAlive()) {
+            append(JournalOp::Kill, index, npc);
+        }
+        saved.push_back({npc.getX(), npc.getY(), npc.isAlive()});
+    }
     
-    NPCVisitor visitor(range, observable);
+    if (!entries.empty()) {
+        DungeonSnapshot::appendJournal(journalPath, journalEnd, entries);
+        journalEnd += entries.size();
+    }
+    dirty.clear();
+}
+
+size_t DungeonEditor::pendingChanges() const {
+    return dirty.size() + (npcs.size() - std::min(saved.size(), npcs.size()));
+}
+
+void DungeonEditor::resetJournal(const std::string& path, uint64_t end) {
+    journalPath = path;
+    journalEnd = end;
+    dirty.clear();
+    saved.clear();
+    if (path.empty()) return;
+    saved.reserve(npcs.size());
+    for (const auto& npc : npcs) {
+        saved.push_back({npc->getX(), npc->getY(), npc->isAlive()});
+    }
+}
+
+void DungeonEditor::battle(int range) {
+    // Шина и наблюдатели создаются при первом бое и живут с редактором:
+    // лог не открывается заново и поток записи не создается на каждый бой
+    if (!battleLog) {
+        battleLog = std::make_shared<FileObserver>();
+        battleEvents.addObserver(std::make_shared<ConsoleObserver>());
+        battleEvents.addObserver(battleLog);
+    }
+    
+    NPCVisitor visitor(range, battleEvents);
     visitor.fight(npcs);
+    battleLog->flush();
+    
+    for (size_t i = 0; i < saved.size(); ++i) {
+        if (saved[i].alive && !npcs[i]->isAlive()) {
+            dirty.push_back(i);
+        }
+    }
+}
+
+void DungeonEditor::battle() {
+    battle(config.killDistance);
+}
+
+const WorldConfig& DungeonEditor::getConfig() const {
+    return config;
 }
 
 const std::vector<std::shared_ptr<NPC>>& DungeonEditor::getNPCs() const {
@@ -2,22 +2,70 @@
 #define DUNGEON_EDITOR_H
 
 #include "npc.h"
+#include "observer.h"
+#include "world_config.h"
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <string>
 
 class DungeonEditor {
 public:
+    // Границы 0-500, как раньше
+    DungeonEditor();
+    // Координаты проверяются по карте config, бой - config.killDistance:
+    // подземелье, собранное с той же конфигурацией, что и движок, не обрезается
+    explicit DungeonEditor(const WorldConfig& config);
+    
     void addNPC(NPCType type, int x, int y, const std::string& name);
+    void moveNPC(size_t index, int x, int y);
     void printAll() const;
     void save(const std::string& filename) const;
+    // Снимок без мертвых NPC; сами NPC и их индексы не меняются.
+    // Перезапись текущей базы saveDelta отцепляет журнал: дальше нужен compact
+    void saveSnapshot(const std::string& filename);
+    // Формат определяется по заголовку: бинарный снимок или текст.
+    // Загруженный снимок становится базой для saveDelta; его записи
+    // копируются в NPC, файл после load не держится отображенным.
+    // NPC вне карты конфигурации - ошибка, а не тихое обрезание.
     void load(const std::string& filename);
     void battle(int range);
+    void battle();
+    
+    const WorldConfig& getConfig() const;
+    
+    // Пишет свежий снимок без журнала и выбрасывает мертвых NPC,
+    // файл становится базой для saveDelta
+    void compact(const std::string& filename);
+    // Дописывает в базовый снимок изменения (addNPC, moveNPC, смерти в battle)
+    // с последнего сохранения; стоимость пропорциональна числу изменений.
+    // Изменения NPC в обход редактора не отслеживаются.
+    void saveDelta();
+    size_t pendingChanges() const;
     
     const std::vector<std::shared_ptr<NPC>>& getNPCs() const;
 
 private:
+    // Состояние NPC, записанное в базовый снимок с журналом
+    struct SavedState {
+        int x;
+        int y;
+        bool alive;
+    };
+    
+    void resetJournal(const std::string& path, uint64_t end);
+    void checkBounds(int x, int y) const;
+    
+    WorldConfig config;
     std::vector<std::shared_ptr<NPC>> npcs;
+    
+    std::string journalPath;
+    uint64_t journalEnd = 0;
+    std::vector<SavedState> saved;
+    std::vector<size_t> dirty;  // индексы измененных NPC, возможны повторы
+    
+    Observable battleEvents;
+    std::shared_ptr<FileObserver> battleLog;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,194 @@
+#include "dungeon_parser.h"
+#include "factory.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <iterator>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+namespace {
+
+struct AppendNPC {
+    std::vector<std::shared_ptr<NPC>>& out;
+
+    void operator()(const NPCRecord& record) const {
+        out.push_back(NPCFactory::create(record.type, record.x, record.y, NameTable::global().intern(record.name)));
+    }
+};
+
+}
+
+bool parseDungeon(std::string_view text, std::vector<std::shared_ptr<NPC>>& out, ParseError& error) {
+    size_t line = 0;
+    return parseDungeonText(text, AppendNPC{out}, error, line);
+}
+
+bool parseDungeonFile(const std::string& filename, std::vector<std::shared_ptr<NPC>>& out, ParseError& error,
+                      size_t readBlock) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        error.line = 0;
+        error.message = "Cannot open file: " + filename;
+        return false;
+    }
+
+    // В буфере хранится незаконченная строка предыдущего блока, за ней - новый блок
+    std::vector<char> buffer(readBlock);
+    size_t carry = 0;
+    size_t line = 0;
+    AppendNPC append{out};
+
+    while (true) {
+        if (buffer.size() - carry < readBlock / 2) {
+            buffer.resize(buffer.size() * 2);  // строка длиннее блока
+        }
+        file.read(buffer.data() + carry, static_cast<std::streamsize>(buffer.size() - carry));
+        size_t filled = carry + static_cast<size_t>(file.gcount());
+        bool eof = !file;
+
+        size_t complete = filled;
+        if (!eof) {
+            const char* data = buffer.data();
+            while (complete > 0 && data[complete - 1] != '\n') --complete;
+        }
+
+        if (!parseDungeonText(std::string_view(buffer.data(), complete), append, error, line)) {
+            return false;
+        }
+        if (eof) return true;
+
+        carry = filled - complete;
+        std::memmove(buffer.data(), buffer.data() + complete, carry);
+    }
+}
+
+bool parseDungeonParallel(std::string_view text, std::vector<std::shared_ptr<NPC>>& out, ParseError& error,
+                          ThreadPool& pool, size_t minChunk) {
+    // Имена интернируются не по записи: глобальная таблица под блокировкой
+    // выстроила бы куски в очередь. Кусок собирает свои различные имена,
+    // затем они разом добавляются в таблицу, и уже после этого параллельно
+    // создаются NPC.
+    struct Record {
+        NPCType type;
+        int x;
+        int y;
+        uint32_t name;  // индекс в Chunk::names
+    };
+    struct Chunk {
+        std::vector<Record> records;
+        std::vector<std::string_view> names;  // указывают в text
+        std::vector<NameId> nameIds;
+        std::vector<std::shared_ptr<NPC>> npcs;
+        ParseError error;
+        size_t lines = 0;
+        bool ok = true;
+    };
+
+    // Несколько кусков на поток сглаживают разницу в длине строк
+    size_t count = std::max<size_t>(1, std::min(text.size() / std::max<size_t>(minChunk, 1), pool.size() * 4));
+    std::vector<size_t> bounds(count + 1, text.size());
+    bounds[0] = 0;
+    for (size_t k = 1; k < count; ++k) {
+        size_t from = std::max(bounds[k - 1], text.size() / count * k);
+        size_t eol = text.find('\n', from);
+        bounds[k] = eol == std::string_view::npos ? text.size() : eol + 1;
+    }
+
+    std::vector<Chunk> chunks(count);
+    pool.parallelFor(count, [&](size_t k) {
+        Chunk& chunk = chunks[k];
+        std::string_view part = text.substr(bounds[k], bounds[k + 1] - bounds[k]);
+        chunk.records.reserve(part.size() / 16);
+        std::unordered_map<std::string_view, uint32_t> local;
+        chunk.ok = parseDungeonText(part, [&](const NPCRecord& record) {
+            auto [it, added] = local.try_emplace(record.name, static_cast<uint32_t>(chunk.names.size()));
+            if (added) chunk.names.push_back(record.name);
+            chunk.records.push_back({record.type, record.x, record.y, it->second});
+        }, chunk.error, chunk.lines);
+    });
+
+    // Куски после ошибочного не нужны: в out попадает только префикс до ошибки
+    size_t used = count;
+    for (size_t k = 0; k < count; ++k) {
+        if (!chunks[k].ok) {
+            used = k + 1;
+            break;
+        }
+    }
+    for (size_t k = 0; k < used; ++k) {
+        Chunk& chunk = chunks[k];
+        chunk.nameIds.resize(chunk.names.size());
+        NameTable::global().intern(chunk.names.data(), chunk.names.size(), chunk.nameIds.data());
+    }
+    pool.parallelFor(used, [&](size_t k) {
+        Chunk& chunk = chunks[k];
+        chunk.npcs.reserve(chunk.records.size());
+        for (const Record& r : chunk.records) {
+            chunk.npcs.push_back(NPCFactory::create(r.type, r.x, r.y, chunk.nameIds[r.name]));
+        }
+    });
+
+    size_t total = 0;
+    for (const Chunk& chunk : chunks) total += chunk.npcs.size();
+    out.reserve(out.size() + total);
+
+    size_t lineBase = 0;
+    for (size_t k = 0; k < used; ++k) {
+        Chunk& chunk = chunks[k];
+        out.insert(out.end(), std::make_move_iterator(chunk.npcs.begin()), std::make_move_iterator(chunk.npcs.end()));
+        if (!chunk.ok) {
+            error = std::move(chunk.error);
+            error.line += lineBase;
+            return false;
+        }
+        lineBase += chunk.lines;
+    }
+    return true;
+}
+
+void formatDungeon(const std::vector<std::shared_ptr<NPC>>& npcs, size_t first, size_t last, std::string& out) {
+    char digits[16];
+    auto appendInt = [&](int value) {
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        out.append(digits, result.ptr);
+    };
+
+    for (size_t i = first; i < last; ++i) {
+        const NPC& npc = *npcs[i];
+        if (!npc.isAlive()) continue;
+        out += npcTypeToken(npc.getType());
+        out += ' ';
+        appendInt(npc.getX());
+        out += ' ';
+        appendInt(npc.getY());
+        out += ' ';
+        out += npc.getName();
+        out += '\n';
+    }
+}
+
+bool writeDungeonParallel(const std::string& filename, const std::vector<std::shared_ptr<NPC>>& npcs,
+                          ThreadPool& pool, size_t chunkNPCs) {
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return false;
+
+    // Волнами по size() кусков: память ограничена буферами потоков, порядок сохраняется
+    chunkNPCs = std::max<size_t>(chunkNPCs, 1);
+    const size_t chunks = (npcs.size() + chunkNPCs - 1) / chunkNPCs;
+    std::vector<std::string> buffers(std::max<size_t>(pool.size(), 1));
+
+    for (size_t wave = 0; wave < chunks; wave += buffers.size()) {
+        const size_t inWave = std::min(buffers.size(), chunks - wave);
+        pool.parallelFor(inWave, [&](size_t k) {
+            size_t first = (wave + k) * chunkNPCs;
+            size_t last = std::min(first + chunkNPCs, npcs.size());
+            buffers[k].clear();
+            formatDungeon(npcs, first, last, buffers[k]);
+        });
+        for (size_t k = 0; k < inWave; ++k) {
+            file.write(buffers[k].data(), static_cast<std::streamsize>(buffers[k].size()));
+        }
+    }
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,124 @@
+#ifndef DUNGEON_PARSER_H
+#define DUNGEON_PARSER_H
+
+#include "npc.h"
+#include "game_constants.h"
+#include <charconv>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class ThreadPool;
+
+// Потоковый разбор текстового формата "Type x y name" без исключений.
+// Строки разбираются как string_view, числа - через std::from_chars;
+// память выделяется только под сами NPC и под текст ошибки.
+
+struct ParseError {
+    size_t line = 0;        // номер строки с 1; 0 - ошибка вне строк (например, файл не открылся)
+    std::string message;
+
+    std::string toString() const {
+        return line ? "line " + std::to_string(line) + ": " + message : message;
+    }
+};
+
+struct NPCRecord {
+    NPCType type;
+    int x;
+    int y;
+    std::string_view name;  // указывает в разбираемый буфер
+};
+
+// Разбирает одну строку без перевода строки. Грамматика и сообщения - как у
+// прежнего разбора через istringstream (iss >> type >> x >> y, затем имя до
+// конца строки): числа со знаком '+' или '-', после y пробел не обязателен
+// ("Bear 1 2Name" - имя "Name"), ошибка формата проверяется раньше типа.
+// Завершающий '\r' отбрасывается, как при чтении файла в текстовом режиме.
+inline bool parseNPCLine(std::string_view line, NPCRecord& record, std::string& error) {
+    const char* p = line.data();
+    const char* end = p + line.size();
+    if (p != end && end[-1] == '\r') --end;
+
+    // Пробельные символы istream в локали "C", кроме '\n'
+    auto isSpace = [](char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f'; };
+    auto skipSpaces = [&]() {
+        while (p != end && isSpace(*p)) ++p;
+    };
+    // Как operator>>(int): знак, затем хотя бы одна цифра; переполнение - ошибка
+    auto readInt = [&](int& value) {
+        skipSpaces();
+        if (p != end && *p == '+') {
+            ++p;
+            if (p == end || *p < '0' || *p > '9') return false;
+        }
+        auto result = std::from_chars(p, end, value);
+        if (result.ec != std::errc()) return false;
+        p = result.ptr;
+        return true;
+    };
+
+    skipSpaces();
+    const char* token = p;
+    while (p != end && !isSpace(*p)) ++p;
+    std::string_view typeStr(token, static_cast<size_t>(p - token));
+    if (typeStr.empty() || !readInt(record.x) || !readInt(record.y)) {
+        error = "Invalid NPC data format";
+        return false;
+    }
+
+    if (!npcTypeFromToken(typeStr, record.type)) {
+        error = "Unknown NPC type: " + std::string(typeStr);
+        return false;
+    }
+
+    skipSpaces();
+    record.name = std::string_view(p, static_cast<size_t>(end - p));
+    return true;
+}
+
+// Разбирает буфер целиком; onRecord(const NPCRecord&) вызывается для каждой строки.
+// Пустые строки пропускаются. line - номер последней разобранной строки,
+// продолжается между вызовами при потоковом чтении.
+template <typename OnRecord>
+bool parseDungeonText(std::string_view text, OnRecord&& onRecord, ParseError& error, size_t& line) {
+    NPCRecord record;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t eol = text.find('\n', pos);
+        if (eol == std::string_view::npos) eol = text.size();
+        std::string_view current = text.substr(pos, eol - pos);
+        pos = eol + 1;
+        ++line;
+
+        if (current.empty() || (current.size() == 1 && current[0] == '\r')) continue;
+        if (!parseNPCLine(current, record, error.message)) {
+            error.line = line;
+            return false;
+        }
+        onRecord(record);
+    }
+    return true;
+}
+
+// Разбор в контейнер DungeonEditor. При ошибке out содержит NPC до ошибочной строки.
+bool parseDungeon(std::string_view text, std::vector<std::shared_ptr<NPC>>& out, ParseError& error);
+// Читает файл блоками по readBlock байт и разбирает их по мере чтения
+bool parseDungeonFile(const std::string& filename, std::vector<std::shared_ptr<NPC>>& out, ParseError& error,
+                      size_t readBlock = size_t(1) << 20);
+
+// Делит текст на куски по границам строк, разбирает их на пуле и склеивает
+// результат в исходном порядке. Номер строки в ошибке - сквозной.
+bool parseDungeonParallel(std::string_view text, std::vector<std::shared_ptr<NPC>>& out, ParseError& error,
+                          ThreadPool& pool, size_t minChunk = PARALLEL_IO_CHUNK_BYTES);
+
+// Дописывает живых NPC из [first, last) в out в текстовом формате
+void formatDungeon(const std::vector<std::shared_ptr<NPC>>& npcs, size_t first, size_t last, std::string& out);
+// Форматирует куски по chunkNPCs на пуле, по одному буферу на поток, и пишет
+// каждый буфер одним вызовом write. false - файл не открылся или запись не удалась.
+bool writeDungeonParallel(const std::string& filename, const std::vector<std::shared_ptr<NPC>>& npcs,
+                          ThreadPool& pool, size_t chunkNPCs = PARALLEL_IO_CHUNK_NPCS);
+
+#endif
@@ -0,0 +1,167 @@
+#include "dungeon_snapshot.h"
+#include "mapped_file.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+DungeonSnapshot::DungeonSnapshot(const std::string& filename)
+    : mapping(std::make_unique<MappedFile>(filename)) {
+    const char* data = mapping->data();
+    const size_t size = mapping->size();
+
+    if (size < sizeof(SnapshotHeader) || std::memcmp(data, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+        throw std::runtime_error("Not a dungeon snapshot: " + filename);
+    }
+    header = reinterpret_cast<const SnapshotHeader*>(data);
+    if (header->version != SNAPSHOT_VERSION) {
+        throw std::runtime_error("Unsupported snapshot version: " + std::to_string(header->version));
+    }
+
+    const uint64_t recordsEnd = sizeof(SnapshotHeader) + uint64_t(header->recordCount) * sizeof(SnapshotRecord);
+    // Без сложения: сумма двух 64-битных полей из файла может переполниться
+    if (recordsEnd > size || header->stringTableOffset < recordsEnd ||
+        header->stringTableOffset > size || header->stringTableSize > size - header->stringTableOffset) {
+        throw std::runtime_error("Corrupted snapshot: " + filename);
+    }
+    records = reinterpret_cast<const SnapshotRecord*>(data + sizeof(SnapshotHeader));
+    strings = data + header->stringTableOffset;
+    journal = strings + header->stringTableSize;
+    journalSize = size - static_cast<size_t>(header->stringTableOffset + header->stringTableSize);
+
+    for (size_t i = 0; i < header->recordCount; ++i) {
+        const SnapshotRecord& r = records[i];
+        if (!isNPCType(r.type) ||
+            uint64_t(r.nameOffset) + r.nameLength > header->stringTableSize) {
+            throw std::runtime_error("Corrupted snapshot record " + std::to_string(i) + ": " + filename);
+        }
+    }
+
+    // Находим конец последней целой записи журнала
+    journalValid = 0;
+    JournalEntry entry;
+    std::string_view entryName;
+    while (nextJournalEntry(journalValid, entry, entryName)) {
+    }
+}
+
+DungeonSnapshot::~DungeonSnapshot() = default;
+
+size_t DungeonSnapshot::size() const {
+    return header->recordCount;
+}
+
+const SnapshotRecord& DungeonSnapshot::record(size_t i) const {
+    return records[i];
+}
+
+NPCType DungeonSnapshot::type(size_t i) const {
+    return static_cast<NPCType>(records[i].type);
+}
+
+std::string_view DungeonSnapshot::name(size_t i) const {
+    return std::string_view(strings + records[i].nameOffset, records[i].nameLength);
+}
+
+bool DungeonSnapshot::nextJournalEntry(size_t& offset, JournalEntry& entry, std::string_view& name) const {
+    if (offset + sizeof(JournalEntry) > journalSize) return false;
+    std::memcpy(&entry, journal + offset, sizeof(JournalEntry));
+    size_t nameBytes = entry.op == static_cast<uint8_t>(JournalOp::Add) ? entry.nameLength : 0;
+    if (offset + sizeof(JournalEntry) + nameBytes > journalSize) return false;
+
+    if (entry.op < static_cast<uint8_t>(JournalOp::Add) || entry.op > static_cast<uint8_t>(JournalOp::Kill) ||
+        !isNPCType(entry.type)) {
+        throw std::runtime_error("Corrupted snapshot journal at offset " + std::to_string(offset));
+    }
+    name = std::string_view(journal + offset + sizeof(JournalEntry), nameBytes);
+    offset += sizeof(JournalEntry) + nameBytes;
+    return true;
+}
+
+uint64_t DungeonSnapshot::journalEnd() const {
+    return header->stringTableOffset + header->stringTableSize + journalValid;
+}
+
+bool DungeonSnapshot::isSnapshot(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    char magic[sizeof(SNAPSHOT_MAGIC)] = {0};
+    file.read(magic, sizeof(magic));
+    return file.gcount() == sizeof(magic) && std::memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0;
+}
+
+void DungeonSnapshot::encodeJournalEntry(std::string& out, const JournalEntry& entry, std::string_view name) {
+    out.append(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    out.append(name.data(), name.size());
+}
+
+void DungeonSnapshot::appendJournal(const std::string& filename, uint64_t validEnd, const std::string& entries) {
+    std::error_code ec;
+    if (std::filesystem::file_size(filename, ec) < validEnd || ec) {
+        throw std::runtime_error("Snapshot was modified externally: " + filename);
+    }
+    std::filesystem::resize_file(filename, validEnd, ec);
+    if (ec) {
+        throw std::runtime_error("Cannot truncate file: " + filename);
+    }
+
+    std::ofstream file(filename, std::ios::binary | std::ios::app);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open file: " + filename);
+    }
+    file.write(entries.data(), static_cast<std::streamsize>(entries.size()));
+    if (!file) {
+        throw std::runtime_error("Cannot write file: " + filename);
+    }
+}
+
+void DungeonSnapshot::checkLimits(uint64_t recordCount, uint64_t nameOffset) {
+    // Усечение дало бы снимок, который загружается, но с чужими именами
+    if (recordCount > UINT32_MAX) {
+        throw std::runtime_error("Too many NPCs for snapshot: " + std::to_string(recordCount));
+    }
+    if (nameOffset > UINT32_MAX) {
+        throw std::runtime_error("NPC names too large for snapshot: " + std::to_string(nameOffset) + " bytes");
+    }
+}
+
+void DungeonSnapshot::write(const std::string& filename, const std::vector<std::shared_ptr<NPC>>& npcs) {
+    // Как и текстовый формат, сохраняем только живых NPC
+    std::vector<SnapshotRecord> out;
+    std::string table;
+    out.reserve(npcs.size());
+    for (const auto& npc : npcs) {
+        if (!npc->isAlive()) continue;
+        const std::string& name = npc->getName();
+        if (name.size() > UINT16_MAX) {
+            throw std::runtime_error("NPC name too long for snapshot: " + name.substr(0, 32));
+        }
+        checkLimits(out.size() + 1, table.size());
+        SnapshotRecord record;
+        record.x = npc->getX();
+        record.y = npc->getY();
+        record.nameOffset = static_cast<uint32_t>(table.size());
+        record.nameLength = static_cast<uint16_t>(name.size());
+        record.type = static_cast<uint8_t>(npc->getType());
+        record.flags = 0;
+        out.push_back(record);
+        table += name;
+    }
+
+    SnapshotHeader header;
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.recordCount = static_cast<uint32_t>(out.size());
+    header.stringTableOffset = sizeof(SnapshotHeader) + out.size() * sizeof(SnapshotRecord);
+    header.stringTableSize = table.size();
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open file: " + filename);
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size() * sizeof(SnapshotRecord)));
+    file.write(table.data(), static_cast<std::streamsize>(table.size()));
+    if (!file) {
+        throw std::runtime_error("Cannot write file: " + filename);
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef DUNGEON_SNAPSHOT_H
+#define DUNGEON_SNAPSHOT_H
+
+#include "npc.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class MappedFile;
+
+// Бинарный снимок подземелья (little-endian):
+//   SnapshotHeader
+//   recordCount x SnapshotRecord (фиксированная ширина, 16 байт)
+//   таблица строк: имена подряд, без разделителей
+// Имя записи - срез [nameOffset, nameOffset + nameLength) таблицы строк.
+constexpr char SNAPSHOT_MAGIC[8] = {'B', 'F', '3', 'D', 'U', 'N', 'G', '\0'};
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+#pragma pack(push, 1)
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordCount;
+    uint64_t stringTableOffset;
+    uint64_t stringTableSize;
+};
+
+struct SnapshotRecord {
+    int32_t x;
+    int32_t y;
+    uint32_t nameOffset;
+    uint16_t nameLength;
+    uint8_t type;      // NPCType
+    uint8_t flags;     // зарезервировано, 0
+};
+
+// Журнал изменений дописывается в конец снимка (см. DungeonEditor::saveDelta).
+// За записью Add следует имя длиной nameLength.
+struct JournalEntry {
+    uint8_t op;        // JournalOp
+    uint8_t type;      // NPCType, только для Add
+    uint16_t nameLength;
+    uint32_t index;    // индекс NPC в порядке загрузки
+    int32_t x;
+    int32_t y;
+};
+#pragma pack(pop)
+
+enum class JournalOp : uint8_t {
+    Add = 1,
+    Move = 2,
+    Kill = 3
+};
+
+static_assert(sizeof(SnapshotHeader) == 32, "SnapshotHeader layout");
+static_assert(sizeof(SnapshotRecord) == 16, "SnapshotRecord layout");
+static_assert(sizeof(JournalEntry) == 16, "JournalEntry layout");
+
+// Снимок, отображенный в память: записи и имена читаются прямо из файла
+// без копирования. Файл проверяется при открытии.
+// DungeonEditor::load этим не пользуется: он копирует записи в NPC
+// (см. NPCFactory::loadFromSnapshot).
+class DungeonSnapshot {
+public:
+    explicit DungeonSnapshot(const std::string& filename);
+    ~DungeonSnapshot();
+
+    DungeonSnapshot(const DungeonSnapshot&) = delete;
+    DungeonSnapshot& operator=(const DungeonSnapshot&) = delete;
+
+    size_t size() const;
+    const SnapshotRecord& record(size_t i) const;
+    NPCType type(size_t i) const;
+    std::string_view name(size_t i) const;
+
+    // Обход журнала: offset начинается с 0, false - журнал закончился.
+    // Оборванная последняя запись (сбой при дописывании) считается концом.
+    bool nextJournalEntry(size_t& offset, JournalEntry& entry, std::string_view& name) const;
+    // Смещение в файле сразу за последней целой записью журнала
+    uint64_t journalEnd() const;
+
+    // true, если файл начинается с SNAPSHOT_MAGIC
+    static bool isSnapshot(const std::string& filename);
+    static void write(const std::string& filename, const std::vector<std::shared_ptr<NPC>>& npcs);
+    // recordCount и nameOffset - 32-битные поля: runtime_error, если записей
+    // или байт имен перед записью больше, чем в них помещается
+    static void checkLimits(uint64_t recordCount, uint64_t nameOffset);
+    static void encodeJournalEntry(std::string& out, const JournalEntry& entry, std::string_view name = {});
+    // Обрезает файл до validEnd (хвост оборванной записи) и дописывает entries
+    static void appendJournal(const std::string& filename, uint64_t validEnd, const std::string& entries);
+
+private:
+    std::unique_ptr<MappedFile> mapping;
+
+    const SnapshotHeader* header;
+    const SnapshotRecord* records;
+    const char* strings;
+    const char* journal;
+    size_t journalSize;
+    size_t journalValid;
+};
+
+#endif
@@ -1,77 +1,159 @@
 #include "factory.h"
+#include "dungeon_snapshot.h"
+#include "dungeon_parser.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+#include "npc_arena.h"
+#include <filesystem>
 #include <fstream>
-#include <sstream>
 #include <stdexcept>
 #include <memory>  // Добавьте эту строку!
 
+namespace {
+
+template <typename Kind>
+std::shared_ptr<NPC> createKind(int x, int y, NameId nameId, NPCArena& arena) {
+    return std::allocate_shared<Kind>(ArenaAllocator<Kind>(arena), x, y, nameId);
+}
+
+struct KindCreator {
+    NPCType type;
+    std::shared_ptr<NPC> (*create)(int x, int y, NameId nameId, NPCArena& arena);
+};
+
+template <typename Kind>
+constexpr KindCreator kindCreator() {
+    return {Kind::TYPE, &createKind<Kind>};
+}
+
+// Конкретный класс на каждую строку NPC_TYPES, в том же порядке
+constexpr KindCreator CREATORS[] = {
+    kindCreator<Bear>(),
+    kindCreator<Werewolf>(),  // Изменено с Elf на Werewolf
+    kindCreator<Rogue>(),
+};
+
+constexpr bool creatorsMatchTypes() {
+    if (sizeof(CREATORS) / sizeof(CREATORS[0]) != NPC_TYPE_COUNT) return false;
+    for (size_t t = 0; t < NPC_TYPE_COUNT; ++t) {
+        if (CREATORS[t].type != NPC_TYPES[t].type) return false;
+    }
+    return true;
+}
+
+static_assert(creatorsMatchTypes(), "CREATORS needs one class per NPC_TYPES row, in NPCType order");
+
+}
+
 std::shared_ptr<NPC> NPCFactory::create(NPCType type, int x, int y, const std::string& name) {
-    switch (type) {
-        case NPCType::Bear:
-            return std::make_shared<Bear>(x, y, name);
-        case NPCType::Werewolf:  // Изменено с Elf на Werewolf
-            return std::make_shared<Werewolf>(x, y, name);
-        case NPCType::Rogue:
-            return std::make_shared<Rogue>(x, y, name);
-        default:
-            throw std::runtime_error("Unknown NPC type");
+    return create(type, x, y, NameTable::global().intern(name));
+}
+
+std::shared_ptr<NPC> NPCFactory::create(NPCType type, int x, int y, NameId nameId) {
+    return create(type, x, y, nameId, NPCArena::global());
+}
+
+std::shared_ptr<NPC> NPCFactory::create(NPCType type, int x, int y, NameId nameId, NPCArena& arena) {
+    if (!isNPCType(static_cast<unsigned>(type))) {
+        throw std::runtime_error("Unknown NPC type");
     }
+    return CREATORS[static_cast<size_t>(type)].create(x, y, nameId, arena);
 }
 
 std::shared_ptr<NPC> NPCFactory::loadFromString(const std::string& data) {
-    std::istringstream iss(data);
-    std::string typeStr;
-    std::string name;
-    int x, y;
-    
-    if (!(iss >> typeStr >> x >> y)) {
-        throw std::runtime_error("Invalid NPC data format");
+    NPCRecord record;
+    std::string error;
+    if (!parseNPCLine(data, record, error)) {
+        throw std::runtime_error(error);
     }
-    
-    std::getline(iss >> std::ws, name);
-    
-    NPCType type;
-    if (typeStr == "Bear") type = NPCType::Bear;
-    else if (typeStr == "Werewolf") type = NPCType::Werewolf;  // Изменено
-    else if (typeStr == "Rogue") type = NPCType::Rogue;
-    else throw std::runtime_error("Unknown NPC type: " + typeStr);
-    
-    return create(type, x, y, name);
+    return create(record.type, record.x, record.y, NameTable::global().intern(record.name));
 }
 
 std::vector<std::shared_ptr<NPC>> NPCFactory::loadFromFile(const std::string& filename) {
-    std::vector<std::shared_ptr<NPC>> npcs;
-    std::ifstream file(filename);
-    
-    if (!file.is_open()) {
-        throw std::runtime_error("Cannot open file: " + filename);
+    std::error_code ec;
+    auto bytes = std::filesystem::file_size(filename, ec);
+    if (!ec && bytes >= PARALLEL_IO_MIN_BYTES) {
+        ThreadPool pool;
+        return loadFromFile(filename, pool);
     }
     
-    std::string line;
-    while (std::getline(file, line)) {
-        if (!line.empty()) {
-            npcs.push_back(loadFromString(line));
-        }
+    std::vector<std::shared_ptr<NPC>> npcs;
+    ParseError error;
+    if (!parseDungeonFile(filename, npcs, error)) {
+        throw std::runtime_error(error.line ? filename + ": " + error.toString() : error.message);
+    }
+    return npcs;
+}
+
+std::vector<std::shared_ptr<NPC>> NPCFactory::loadFromFile(const std::string& filename, ThreadPool& pool) {
+    MappedFile file(filename);
+    std::vector<std::shared_ptr<NPC>> npcs;
+    ParseError error;
+    if (!parseDungeonParallel(file.view(), npcs, error, pool)) {
+        throw std::runtime_error(filename + ": " + error.toString());
     }
-    
     return npcs;
 }
 
 void NPCFactory::saveToFile(const std::string& filename, const std::vector<std::shared_ptr<NPC>>& npcs) {
-    std::ofstream file(filename);
+    if (npcs.size() >= 2 * PARALLEL_IO_CHUNK_NPCS) {
+        ThreadPool pool;
+        saveToFile(filename, npcs, pool);
+        return;
+    }
     
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
     if (!file.is_open()) {
         throw std::runtime_error("Cannot open file: " + filename);
     }
+    std::string buffer;
+    formatDungeon(npcs, 0, npcs.size(), buffer);
+    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
+
+void NPCFactory::saveToFile(const std::string& filename, const std::vector<std::shared_ptr<NPC>>& npcs, ThreadPool& pool) {
+    if (!writeDungeonParallel(filename, npcs, pool)) {
+        throw std::runtime_error("Cannot write file: " + filename);
+    }
+}
+
+std::vector<std::shared_ptr<NPC>> NPCFactory::loadFromSnapshot(const std::string& filename) {
+    DungeonSnapshot snapshot(filename);
+    return loadFromSnapshot(snapshot);
+}
+
+std::vector<std::shared_ptr<NPC>> NPCFactory::loadFromSnapshot(const DungeonSnapshot& snapshot) {
+    std::vector<std::shared_ptr<NPC>> npcs;
+    npcs.reserve(snapshot.size());
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        const SnapshotRecord& record = snapshot.record(i);
+        npcs.push_back(create(snapshot.type(i), record.x, record.y, NameTable::global().intern(snapshot.name(i))));
+    }
     
-    for (const auto& npc : npcs) {
-        if (npc->isAlive()) {
-            std::string typeStr;
-            switch (npc->getType()) {
-                case NPCType::Bear: typeStr = "Bear"; break;
-                case NPCType::Werewolf: typeStr = "Werewolf"; break;  // Изменено
-                case NPCType::Rogue: typeStr = "Rogue"; break;
-            }
-            file << typeStr << " " << npc->getX() << " " << npc->getY() << " " << npc->getName() << std::endl;
+    // Повтор журнала поверх базового снимка
+    size_t offset = 0;
+    JournalEntry entry;
+    std::string_view name;
+    while (snapshot.nextJournalEntry(offset, entry, name)) {
+        auto op = static_cast<JournalOp>(entry.op);
+        if (op == JournalOp::Add ? entry.index != npcs.size() : entry.index >= npcs.size()) {
+            throw std::runtime_error("Corrupted snapshot journal: bad NPC index " + std::to_string(entry.index));
+        }
+        switch (op) {
+            case JournalOp::Add:
+                npcs.push_back(create(static_cast<NPCType>(entry.type), entry.x, entry.y, NameTable::global().intern(name)));
+                break;
+            case JournalOp::Move:
+                npcs[entry.index]->setPosition(entry.x, entry.y);
+                break;
+            case JournalOp::Kill:
+                npcs[entry.index]->markDead();
+                break;
         }
     }
+    return npcs;
+}
+
+void NPCFactory::saveToSnapshot(const std::string& filename, const std::vector<std::shared_ptr<NPC>>& npcs) {
+    DungeonSnapshot::write(filename, npcs);
 }
\ No newline at end of file
@@ -6,12 +6,33 @@
 #include <string>
 #include <vector>
 
+class ThreadPool;
+class DungeonSnapshot;
+class NPCArena;
+
 class NPCFactory {
 public:
     static std::shared_ptr<NPC> create(NPCType type, int x, int y, const std::string& name);
+    // NPC и счетчик ссылок размещаются одним блоком в NPCArena::global()
+    static std::shared_ptr<NPC> create(NPCType type, int x, int y, NameId nameId);
+    // Отдельная арена: ее слябы освобождаются разом после уничтожения этих NPC
+    static std::shared_ptr<NPC> create(NPCType type, int x, int y, NameId nameId, NPCArena& arena);
     static std::shared_ptr<NPC> loadFromString(const std::string& data);
+    // Большие подземелья (файл от PARALLEL_IO_MIN_BYTES, при записи от
+    // 2 * PARALLEL_IO_CHUNK_NPCS NPC) обрабатываются кусками на временном пуле
     static std::vector<std::shared_ptr<NPC>> loadFromFile(const std::string& filename);
     static void saveToFile(const std::string& filename, const std::vector<std::shared_ptr<NPC>>& npcs);
+    static std::vector<std::shared_ptr<NPC>> loadFromFile(const std::string& filename, ThreadPool& pool);
+    static void saveToFile(const std::string& filename, const std::vector<std::shared_ptr<NPC>>& npcs, ThreadPool& pool);
+
+    // Бинарный снимок (см. dungeon_snapshot.h)
+    // Загружает базовый снимок и применяет его журнал изменений.
+    // Это копия, а не view: редактор отдает изменяемые shared_ptr<NPC>
+    // (getNPCs, battle, moveNPC), а отображение живет только до конца load.
+    // Копируются 16-байтные записи, имена не копируются - только интернируются.
+    static std::vector<std::shared_ptr<NPC>> loadFromSnapshot(const std::string& filename);
+    static std::vector<std::shared_ptr<NPC>> loadFromSnapshot(const DungeonSnapshot& snapshot);
+    static void saveToSnapshot(const std::string& filename, const std::vector<std::shared_ptr<NPC>>& npcs);
 };
 
 #endif
\ No newline at end of file
@@ -1,11 +1,37 @@
 #ifndef GAME_CONSTANTS_H
 #define GAME_CONSTANTS_H
 
+#include <cstddef>
+
+// Значения по умолчанию для WorldConfig (world_config.h); код читает их из конфигурации
+
 constexpr int MAP_WIDTH = 100;
 constexpr int MAP_HEIGHT = 100;
 constexpr int KILL_DISTANCE = 5;
 constexpr int MOVE_DISTANCE = 2;
 constexpr int GAME_DURATION_SECONDS = 30;
+constexpr double TICK_RATE_HZ = 10.0;
 constexpr int INITIAL_NPC_COUNT = 50;
+constexpr size_t WORKER_THREAD_COUNT = 0;  // 0 - по числу ядер
+
+// Верхние пределы WorldConfig::validate: частота выше - это уже step(),
+// потоков больше - почти наверняка опечатка, а не число ядер
+constexpr double MAX_TICK_RATE_HZ = 10000.0;
+constexpr size_t MAX_WORKER_THREADS = 1024;
+
+// Сторона карты редактора без явной WorldConfig: координаты 0-500
+constexpr int EDITOR_MAP_SIZE = 501;
+
+// Начиная с этого числа NPC бой ищет соседей через SpatialGrid (см. rpg_bench)
+constexpr size_t GRID_FIGHT_THRESHOLD = 128;
+
+// Наибольший размер карты на экране в символах; большие карты уменьшаются
+constexpr int MAP_VIEW_MAX_WIDTH = 100;
+constexpr int MAP_VIEW_MAX_HEIGHT = 100;
+
+// Параллельная загрузка/сохранение текстовых подземелий
+constexpr size_t PARALLEL_IO_MIN_BYTES = size_t(8) << 20;   // файлы меньше грузятся потоково
+constexpr size_t PARALLEL_IO_CHUNK_BYTES = size_t(1) << 20; // минимальный кусок разбора
+constexpr size_t PARALLEL_IO_CHUNK_NPCS = 65536;            // NPC на один буфер записи
 
 #endif
\ No newline at end of file
@@ -1,15 +1,51 @@
 #include "game_engine.h"
 #include "game_constants.h"
-#include "factory.h"
-#include "visitor.h"
-#include "observer.h"
+#include "simd_kernels.h"
+#include "alive_bitset.h"
+#include <charconv>
 #include <iostream>
 #include <chrono>
 #include <random>
 #include <iomanip>
+#include <stdexcept>
 
-GameEngine::GameEngine() : randomEngine(std::random_device{}()) {
+namespace {
+
+// Номера случайных потоков подсистем внутри одного прогона
+constexpr uint64_t SPAWN_STREAM = 1;
+constexpr uint64_t MOVE_STREAM = 2;
+constexpr uint64_t COMBAT_STREAM = 3;
+
+}
+
+namespace {
+
+WorldConfig withWorkers(size_t workerThreads) {
+    WorldConfig config;
+    config.workerThreads = workerThreads;
+    return config;
+}
+
+const WorldConfig& validated(const WorldConfig& config) {
+    config.validate();
+    return config;
+}
+
+}
+
+GameEngine::GameEngine(size_t workerThreads, uint64_t seed)
+    : GameEngine(withWorkers(workerThreads), seed) {
+}
+
+GameEngine::GameEngine(const WorldConfig& config, uint64_t seed)
+    : config(validated(config)),
+      mapRenderer(config.mapWidth, config.mapHeight), seed(seed), tickRate(config.tickRate),
+      tiledCombat(config.killDistance), executor(config.workerThreads) {
+    events.addObserver(std::make_shared<ConsoleObserver>());
+    moveSeed = deriveSeed(seed, MOVE_STREAM);
+    combatKey = makeStreamKey(deriveSeed(seed, COMBAT_STREAM));
     initializeNPCs();
+    publishFrame();
 }
 
 GameEngine::~GameEngine() {
@@ -17,256 +53,343 @@ GameEngine::~GameEngine() {
 }
 
 void GameEngine::initializeNPCs() {
-    std::uniform_int_distribution<int> posDist(0, MAP_WIDTH - 1);
-    std::uniform_int_distribution<int> typeDist(0, 2);
+    RngStream spawn(seed, SPAWN_STREAM);
     
-    for (int i = 0; i < INITIAL_NPC_COUNT; ++i) {
-        int x = posDist(randomEngine);
-        int y = posDist(randomEngine);
-        
-        NPCType type;
-        switch (typeDist(randomEngine)) {
-            case 0: type = NPCType::Bear; break;
-            case 1: type = NPCType::Werewolf; break;
-            case 2: type = NPCType::Rogue; break;
-        }
+    world.reserve(config.npcCount);
+    // Появления доставляются после первого тика: наблюдатели, подключенные
+    // до запуска, их получат
+    EventWriter out = events.writer();
+    for (int i = 0; i < config.npcCount; ++i) {
+        int x = spawn.uniformInt(0, config.mapWidth - 1);
+        int y = spawn.uniformInt(0, config.mapHeight - 1);
         
-        std::string name = "NPC_" + std::to_string(i);
-        auto npc = NPCFactory::create(type, x, y, name);
-        npc->setRandomEngine(randomEngine);
+        NPCType type = static_cast<NPCType>(spawn.uniformInt(0, static_cast<int>(NPC_TYPE_COUNT) - 1));
         
-        {
-            std::lock_guard<std::mutex> lock(positionMapMutex);
-            positionMap[{x, y}] = npc;
-        }
-        
-        npcs.push_back(npc);
+        // Имя собирается на стеке: повторные запуски получают те же NameId
+        char name[16] = "NPC_";
+        char* end = std::to_chars(name + 4, name + sizeof(name), i).ptr;
+        NameId nameId = NameTable::global().intern(std::string_view(name, end - name));
+        NPCHandle handle = world.spawn(type, x, y, nameId);
+        out.spawn({0, handle, nameId, x, y, type});
     }
+    positionMap.rebuild(world.handleData(), world.xData(), world.yData(), world.aliveBits(), world.size());
 }
 
 void GameEngine::run() {
     running = true;
     
-    movementWorker = std::thread(&GameEngine::movementThread, this);
-    combatWorker = std::thread(&GameEngine::combatThread, this);
-    printWorker = std::thread(&GameEngine::printMapThread, this);
-    
-    // Ждем 30 секунд
-    std::this_thread::sleep_for(std::chrono::seconds(GAME_DURATION_SECONDS));
-    
-    stop();
-    
-    // Выводим список выживших
     {
-        std::shared_lock<std::shared_mutex> lock(npcsMutex);
         std::lock_guard<std::mutex> coutLock(coutMutex);
-        std::cout << "\n=== SURVIVORS AFTER " << GAME_DURATION_SECONDS << " SECONDS ===" << std::endl;
-        
-        int survivorCount = 0;
-        for (const auto& npc : npcs) {
-            if (npc->isAlive()) {
-                std::string typeStr;
-                switch (npc->getType()) {
-                    case NPCType::Bear: typeStr = "Bear"; break;
-                    case NPCType::Werewolf: typeStr = "Werewolf"; break;
-                    case NPCType::Rogue: typeStr = "Rogue"; break;
-                }
-                std::cout << typeStr << " '" << npc->getName() << "' at (" 
-                          << npc->getX() << ", " << npc->getY() << ")" << std::endl;
-                survivorCount++;
+        std::cout << "Seed: " << seed << std::endl;
+    }
+    
+    // Тики (с частотой tickRate) и кадры карты (раз в секунду) ставятся задачами
+    // в исполнитель; новый тик не ставится, пока не закончился предыдущий
+    using Clock = std::chrono::steady_clock;
+    const auto tickInterval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / tickRate));
+    auto start = Clock::now();
+    auto deadline = start + std::chrono::seconds(config.durationSeconds);
+    auto nextTick = start;
+    auto nextFrame = start;
+    auto nextExport = metricsPath.empty() ? Clock::time_point::max() : start + metricsInterval;
+    
+    while (running && Clock::now() < deadline) {
+        auto now = Clock::now();
+        if (now >= nextTick) {
+            if (!tickInFlight.exchange(true)) {
+                executor.submit([this]() {
+                    simulationTick();
+                    finishTask(tickInFlight);
+                });
             }
+            nextTick += tickInterval;
         }
-        std::cout << "Total survivors: " << survivorCount << std::endl;
+        if (now >= nextFrame) {
+            if (!frameInFlight.exchange(true)) {
+                executor.submit([this]() {
+                    renderMap();
+                    finishTask(frameInFlight);
+                });
+            }
+            nextFrame += std::chrono::seconds(1);
+        }
+        if (now >= nextExport) {
+            exportMetrics();
+            nextExport += metricsInterval;
+        }
+        std::this_thread::sleep_until(std::min({nextTick, nextFrame, nextExport, deadline}));
     }
+    
+    stop();
+    exportMetrics();
+    std::string_view tail = mapRenderer.finish();
+    if (!tail.empty()) {
+        std::lock_guard<std::mutex> coutLock(coutMutex);
+        std::cout.write(tail.data(), static_cast<std::streamsize>(tail.size()));
+    }
+    printSurvivors();
 }
 
-void GameEngine::stop() {
-    running = false;
+StepStats GameEngine::step(uint32_t ticks) {
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    for (uint32_t t = 0; t < ticks; ++t) {
+        simulationTick();
+    }
+    
+    // Доставка последнего тика могла остаться в очереди исполнителя:
+    // ждем ее и отдаем наблюдателям остаток, чтобы после step() они
+    // видели события всех тиков
+    {
+        std::unique_lock<std::mutex> lock(inFlightMutex);
+        inFlightDone.wait(lock, [this] { return !reportInFlight; });
+    }
+    reportEvents();
     
-    if (movementWorker.joinable()) movementWorker.join();
-    if (combatWorker.joinable()) combatWorker.join();
-    if (printWorker.joinable()) printWorker.join();
+    StepStats stats;
+    stats.ticks = ticks;
+    stats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    stats.ticksPerSecond = stats.seconds > 0 ? ticks / stats.seconds : 0.0;
+    stats.survivors = frames.current()->size();
+    return stats;
 }
 
-void GameEngine::movementThread() {
-    Observable observable;
-    auto consoleObserver = std::make_shared<ConsoleObserver>();
-    observable.addObserver(consoleObserver);
+void GameEngine::printSurvivors() {
+    // Выводим список выживших из последнего опубликованного кадра
+    std::shared_ptr<const WorldFrame> frame = frames.current();
+    const NameTable& names = NameTable::global();
+    std::lock_guard<std::mutex> coutLock(coutMutex);
+    std::cout << "\n=== SURVIVORS AFTER " << frame->tick << " TICKS ===" << std::endl;
     
-    NPCVisitor visitor(KILL_DISTANCE, observable);
+    for (size_t i = 0; i < frame->size(); ++i) {
+        std::cout << npcTypeToken(frame->type[i]) << " '" << names.resolve(frame->names[i]) << "' at (" 
+                  << frame->x[i] << ", " << frame->y[i] << ")" << std::endl;
+    }
+    std::cout << "Total survivors: " << frame->size() << std::endl;
     
-    while (running) {
-        {
-            std::shared_lock<std::shared_mutex> lock(npcsMutex);
-            
-            for (size_t i = 0; i < npcs.size() && running; ++i) {
-                auto& npc = npcs[i];
-                if (!npc->isAlive()) continue;
-                
-                int oldX = npc->getX();
-                int oldY = npc->getY();
-                
-                // Двигаем NPC
-                npc->move(MAP_WIDTH, MAP_HEIGHT);
-                
-                int newX = npc->getX();
-                int newY = npc->getY();
-                
-                // Обновляем позицию на карте
-                updatePosition(npc, oldX, oldY, newX, newY);
-                
-                // Проверяем соседей на возможность боя
-                std::vector<std::shared_ptr<NPC>> neighbors;
-                {
-                    std::lock_guard<std::mutex> mapLock(positionMapMutex);
-                    for (int dx = -KILL_DISTANCE; dx <= KILL_DISTANCE; ++dx) {
-                        for (int dy = -KILL_DISTANCE; dy <= KILL_DISTANCE; ++dy) {
-                            if (dx == 0 && dy == 0) continue;
-                            
-                            int checkX = newX + dx;
-                            int checkY = newY + dy;
-                            
-                            if (checkX >= 0 && checkX < MAP_WIDTH && 
-                                checkY >= 0 && checkY < MAP_HEIGHT) {
-                                auto it = positionMap.find({checkX, checkY});
-                                if (it != positionMap.end() && it->second->isAlive()) {
-                                    neighbors.push_back(it->second);
-                                }
-                            }
-                        }
-                    }
-                }
-                
-                // Создаем задачи для боя
-                for (auto& neighbor : neighbors) {
-                    if (visitor.canKill(npc->getType(), neighbor->getType()) ||
-                        visitor.canKill(neighbor->getType(), npc->getType())) {
-                        
-                        combatQueue.push([this, attacker = npc, defender = neighbor]() {
-                            processCombat(attacker, defender);
-                        });
-                    }
-                }
-            }
-        }
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ThreadPool::Stats stats = executor.getStats();
+    std::cout << "Executor: " << stats.workers << " workers, " << stats.executed << " tasks, "
+              << stats.steals << " steals, latency avg " << std::fixed << std::setprecision(1)
+              << stats.avgLatencyUs << " us, max " << stats.maxLatencyUs << " us" << std::endl;
+}
+
+void GameEngine::setRenderMode(RenderMode mode) {
+    if (running) {
+        throw std::runtime_error("Render mode cannot change while the engine is running");
     }
+    mapRenderer = MapRenderer(config.mapWidth, config.mapHeight, MAP_VIEW_MAX_WIDTH, MAP_VIEW_MAX_HEIGHT, mode);
 }
 
-void GameEngine::combatThread() {
-    while (running) {
-        ThreadSafeQueue::Task task;
-        if (combatQueue.tryPop(task)) {
-            task();
-        } else {
-            std::this_thread::sleep_for(std::chrono::milliseconds(50));
-        }
+void GameEngine::addObserver(std::shared_ptr<Observer> observer) {
+    if (running) {
+        throw std::runtime_error("Observers cannot be added while the engine is running");
     }
+    events.addObserver(std::move(observer));
 }
 
-void GameEngine::processCombat(std::shared_ptr<NPC> attacker, std::shared_ptr<NPC> defender) {
-    if (!attacker->isAlive() || !defender->isAlive()) return;
-    
-    Observable observable;
-    auto consoleObserver = std::make_shared<ConsoleObserver>();
-    observable.addObserver(consoleObserver);
+void GameEngine::setTickRate(double ticksPerSecond) {
+    // Те же пределы, что у tick_rate в конфигурации
+    WorldConfig checked = config;
+    checked.tickRate = ticksPerSecond;
+    checked.validate();
+    tickRate = ticksPerSecond;
+}
+
+double GameEngine::getTickRate() const {
+    return tickRate;
+}
+
+std::vector<std::shared_ptr<NPC>> GameEngine::snapshotNPCs() const {
+    return frames.current()->toNPCs();
+}
+
+std::shared_ptr<const WorldFrame> GameEngine::currentFrame() const {
+    return frames.current();
+}
+
+uint64_t GameEngine::frameEpoch() const {
+    return frames.epoch();
+}
+
+void GameEngine::stop() {
+    running = false;
     
-    NPCVisitor visitor(KILL_DISTANCE, observable);
+    // Дожидаемся уже поставленных тика, кадра и доставки событий
+    {
+        std::unique_lock<std::mutex> lock(inFlightMutex);
+        inFlightDone.wait(lock, [this] { return !tickInFlight && !frameInFlight && !reportInFlight; });
+    }
+    reportEvents();
+}
+
+void GameEngine::finishTask(std::atomic<bool>& inFlight) {
+    // Флаг сбрасывается под мьютексом: stop() не пропустит пробуждение
+    // между проверкой условия и засыпанием
+    {
+        std::lock_guard<std::mutex> lock(inFlightMutex);
+        inFlight = false;
+    }
+    inFlightDone.notify_all();
+}
+
+ThreadPool::Stats GameEngine::getExecutorStats() const {
+    return executor.getStats();
+}
+
+ProfileSnapshot GameEngine::getProfile() const {
+    return profiler.snapshot();
+}
+
+void GameEngine::setMetricsOutput(const std::string& path, std::chrono::milliseconds interval) {
+    if (!TickProfiler::enabled) {
+        throw std::runtime_error("Metrics need a build with RPG_PROFILING (cmake -DRPG_PROFILING=ON)");
+    }
+    if (running) {
+        throw std::runtime_error("Metrics output cannot change while the engine is running");
+    }
+    if (interval.count() <= 0) {
+        throw std::runtime_error("Metrics interval must be positive");
+    }
+    metricsPath = path;
+    metricsInterval = interval;
+}
+
+void GameEngine::exportMetrics() const {
+    if (metricsPath.empty()) return;
+    writeMetricsFile(metricsPath, profiler.snapshot(), metricsFormatFor(metricsPath));
+}
+
+uint64_t GameEngine::getSeed() const {
+    return seed;
+}
+
+const WorldConfig& GameEngine::getConfig() const {
+    return config;
+}
+
+uint64_t GameEngine::randomSeed() {
+    std::random_device device;
+    return (static_cast<uint64_t>(device()) << 32) ^ device();
+}
+
+void GameEngine::simulationTick() {
+    RPG_PROFILE_PHASE(profiler, TickPhase::Tick);
+    uint32_t tick = movementTick();
+    uint32_t kills = combatTick(tick);
+    publishFrame();
+    scheduleReport();
+    RPG_PROFILE_TICK(profiler, tick, kills, executor.getStats().queueDepth);
+    (void)kills;
+}
+
+void GameEngine::publishFrame() {
+    RPG_PROFILE_PHASE(profiler, TickPhase::PublishFrame);
+    // Копия живых - линейный проход по массивам мира; затем подмена указателя
+    frames.acquire().capture(world, moveTick);
+    frames.publish();
+}
+
+uint32_t GameEngine::movementTick() {
+    uint32_t tick = moveTick++;
     
-    bool attackerKillsDefender = visitor.canKill(attacker->getType(), defender->getType()) &&
-                                 attacker->tryKill(*defender);
+    // Когда мертвых больше половины, выбрасываем их из массивов мира;
+    // хэндлы живых в positionMap и отчетах остаются прежними
+    {
+        RPG_PROFILE_PHASE(profiler, TickPhase::Compact);
+        world.compactIfSparse();
+    }
     
-    bool defenderKillsAttacker = visitor.canKill(defender->getType(), attacker->getType()) &&
-                                 defender->tryKill(*attacker);
+    // Двигаем всех NPC одним линейным проходом по массивам мира
+    {
+        RPG_PROFILE_PHASE(profiler, TickPhase::Move);
+        world.moveAllBatch(moveSeed, tick, config.mapWidth, config.mapHeight, config.moveDistance);
+    }
     
+    // Перестраиваем разреженную сетку одним проходом по слотам
     {
-        std::lock_guard<std::mutex> coutLock(coutMutex);
-        if (attackerKillsDefender && defenderKillsAttacker) {
-            std::cout << "MUTUAL KILL: " << attacker->getName() << " and " 
-                      << defender->getName() << " killed each other!" << std::endl;
-            defender->markDead();
-            attacker->markDead();
-            removeDeadNPC(defender);
-            removeDeadNPC(attacker);
-        } else if (attackerKillsDefender) {
-            std::cout << attacker->getName() << " killed " << defender->getName() << std::endl;
-            defender->markDead();
-            removeDeadNPC(defender);
-        } else if (defenderKillsAttacker) {
-            std::cout << defender->getName() << " killed " << attacker->getName() << std::endl;
-            attacker->markDead();
-            removeDeadNPC(attacker);
-        }
+        RPG_PROFILE_PHASE(profiler, TickPhase::GridRebuild);
+        positionMap.rebuild(world.handleData(), world.xData(), world.yData(), world.aliveBits(), world.size());
     }
-}
-
-void GameEngine::printMapThread() {
-    while (running) {
-        {
-            std::lock_guard<std::mutex> coutLock(coutMutex);
-            std::cout << "\n=== CURRENT MAP ===" << std::endl;
-            
-            // Создаем карту
-            std::vector<std::vector<char>> map(MAP_HEIGHT, std::vector<char>(MAP_WIDTH, '.'));
-            
-            {
-                std::shared_lock<std::shared_mutex> lock(npcsMutex);
-                for (const auto& npc : npcs) {
-                    if (npc->isAlive()) {
-                        int x = npc->getX();
-                        int y = npc->getY();
-                        
-                        char symbol;
-                        switch (npc->getType()) {
-                            case NPCType::Bear: symbol = 'B'; break;
-                            case NPCType::Werewolf: symbol = 'W'; break;
-                            case NPCType::Rogue: symbol = 'R'; break;
-                        }
-                        
-                        if (x >= 0 && x < MAP_WIDTH && y >= 0 && y < MAP_HEIGHT) {
-                            map[y][x] = symbol;
-                        }
-                    }
-                }
-            }
-            
-            // Печатаем карту
-            for (int y = 0; y < MAP_HEIGHT; ++y) {
-                for (int x = 0; x < MAP_WIDTH; ++x) {
-                    std::cout << map[y][x];
-                }
-                std::cout << std::endl;
+    
+    if (events.wants(EVENT_MOVES)) {
+        RPG_PROFILE_PHASE(profiler, TickPhase::MoveEvents);
+        EventWriter out = events.writer();
+        const NPCHandle* handles = world.handleData();
+        const int32_t* xs = world.xData();
+        const int32_t* ys = world.yData();
+        const uint64_t* bits = world.aliveBits();
+        for (size_t word = 0; word < (world.size() + 63) / 64; ++word) {
+            for (uint64_t live = bits[word]; live != 0; live &= live - 1) {
+                size_t slot = word * 64 + static_cast<size_t>(countTrailingZeros(live));
+                out.move({tick, handles[slot], xs[slot], ys[slot]});
             }
-            std::cout << "Legend: B=Bear, W=Werewolf, R=Rogue, .=empty" << std::endl;
         }
-        
-        std::this_thread::sleep_for(std::chrono::seconds(1));
     }
+    return tick;
 }
 
-void GameEngine::updatePosition(std::shared_ptr<NPC> npc, int oldX, int oldY, int newX, int newY) {
-    std::lock_guard<std::mutex> lock(positionMapMutex);
+uint32_t GameEngine::combatTick(uint32_t tick) {
+    std::vector<KillRecord> kills;
+    {
+        RPG_PROFILE_PHASE(profiler, TickPhase::Combat);
+        kills = tiledCombat.resolve(world, positionMap, executor, combatKey, tick);
+    }
     
-    // Удаляем старую позицию
-    auto oldIt = positionMap.find({oldX, oldY});
-    if (oldIt != positionMap.end() && oldIt->second == npc) {
-        positionMap.erase(oldIt);
+    RPG_PROFILE_PHASE(profiler, TickPhase::KillEvents);
+    uint32_t dead = 0;
+    for (const auto& kill : kills) {
+        removeDeadNPC(kill.victim);
+        dead++;
+        if (kill.mutual) {
+            removeDeadNPC(kill.killer);
+            dead++;
+        }
     }
     
-    // Добавляем новую позицию
-    positionMap[{newX, newY}] = npc;
+    if (kills.empty()) return dead;
+    
+    EventWriter out = events.writer();
+    for (const auto& kill : kills) {
+        out.kill({tick, kill.killer, kill.victim, world.getNameId(kill.killer),
+                  world.getNameId(kill.victim), kill.mutual});
+    }
+    return dead;
 }
 
-void GameEngine::removeDeadNPC(std::shared_ptr<NPC> npc) {
-    std::lock_guard<std::mutex> lock(positionMapMutex);
-    
-    // Удаляем из карты позиций
-    for (auto it = positionMap.begin(); it != positionMap.end();) {
-        if (it->second == npc) {
-            it = positionMap.erase(it);
-        } else {
-            ++it;
-        }
+void GameEngine::scheduleReport() {
+    // Накопленное за тики, пока шла прошлая доставка, уйдет одной пачкой
+    if (!reportInFlight.exchange(true)) {
+        executor.submit([this]() {
+            reportEvents();
+            finishTask(reportInFlight);
+        });
+    }
+}
+
+void GameEngine::reportEvents() {
+    // События - POD-записи с NameId: наблюдатели не трогают мир, который
+    // в это время меняет следующий тик
+    RPG_PROFILED_LOCK(coutLock, coutMutex, profiler, ProfiledLock::Cout);
+    RPG_PROFILE_PHASE(profiler, TickPhase::ReportEvents);
+    events.flush();
+}
+
+void GameEngine::renderMap() {
+    // Кадр берется без блокировок: тик в это время пишет уже следующий.
+    // Буфер собирается вне coutMutex, под ним - одна запись.
+    std::shared_ptr<const WorldFrame> frame = frames.current();
+    std::string_view text;
+    {
+        RPG_PROFILE_PHASE(profiler, TickPhase::Render);
+        text = mapRenderer.render(*frame);
     }
+    
+    RPG_PROFILED_LOCK(coutLock, coutMutex, profiler, ProfiledLock::Cout);
+    std::cout.write(text.data(), static_cast<std::streamsize>(text.size()));
+    std::cout.flush();
+}
+
+void GameEngine::removeDeadNPC(NPCHandle npc) {
+    positionMap.remove(npc);
 }
\ No newline at end of file
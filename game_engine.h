@@ -2,49 +2,139 @@
 #define GAME_ENGINE_H
 
 #include "npc.h"
-#include "thread_safe_queue.h"
+#include "npc_world.h"
+#include "sparse_grid.h"
+#include "thread_pool.h"
+#include "tiled_combat.h"
+#include "observer.h"
+#include "tick_profiler.h"
+#include "world_frame.h"
+#include "map_renderer.h"
+#include "game_constants.h"
+#include "world_config.h"
 #include <vector>
 #include <memory>
 #include <thread>
 #include <atomic>
+#include <chrono>
+#include <string>
 #include <mutex>
-#include <shared_mutex>  // Добавьте
-#include <map>
+#include <condition_variable>
+
+// Итог безголового прогона
+struct StepStats {
+    uint32_t ticks;
+    double seconds;
+    double ticksPerSecond;
+    size_t survivors;
+};
 
 class GameEngine {
 public:
-    GameEngine();
+    // workerThreads - потоки исполнителя для движения, боя и отрисовки, 0 - все ядра.
+    // Все случайные потоки прогона выводятся из seed: с тем же seed прогон
+    // повторяется при любом числе потоков.
+    explicit GameEngine(size_t workerThreads = WORKER_THREAD_COUNT, uint64_t seed = randomSeed());
+    // Размер карты, население, дальности, длительность и потоки из config
+    explicit GameEngine(const WorldConfig& config, uint64_t seed = randomSeed());
     ~GameEngine();
     
+    // Реальное время: тик с частотой tickRate, карта раз в секунду,
+    // config.durationSeconds или до stop()
     void run();
     void stop();
     
+    // Безголовый режим: ticks тиков подряд без ожидания и без карты.
+    // К возврату наблюдатели получили события всех тиков (FileObserver
+    // пишет их в файл фоновым потоком - для чтения файла нужен его flush)
+    StepStats step(uint32_t ticks);
+    void printSurvivors();
+    
+    // Вид карты в run(): Plain - кадры текстом подряд, Ansi - карта закреплена
+    // вверху терминала и обновляется по изменившимся клеткам
+    void setRenderMode(RenderMode mode);
+    
+    // Наблюдатель событий мира (убийства, перемещения, появления); события
+    // доставляются пачками после каждого тика. ConsoleObserver подключен
+    // всегда. Только до run()/step()
+    void addObserver(std::shared_ptr<Observer> observer);
+    
+    void setTickRate(double ticksPerSecond);
+    double getTickRate() const;
+    
+    // Копии живых NPC последнего опубликованного кадра для API редактора
+    std::vector<std::shared_ptr<NPC>> snapshotNPCs() const;
+    
+    // Последний завершенный тик; кадр неизменяем, пока его держат
+    std::shared_ptr<const WorldFrame> currentFrame() const;
+    uint64_t frameEpoch() const;
+    
+    // Глубина очереди, кражи и задержка задач исполнителя
+    ThreadPool::Stats getExecutorStats() const;
+    
+    // Профиль фаз тика, ожидания coutMutex и убийств за тик; без RPG_PROFILING пуст
+    ProfileSnapshot getProfile() const;
+    // Пишет профиль в path раз в interval во время run() и после него; формат
+    // по расширению (metricsFormatFor). runtime_error без RPG_PROFILING
+    void setMetricsOutput(const std::string& path,
+                          std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+    // Немедленная запись профиля в файл из setMetricsOutput, если он задан
+    void exportMetrics() const;
+    
+    uint64_t getSeed() const;
+    const WorldConfig& getConfig() const;
+    static uint64_t randomSeed();
+    
 private:
     void initializeNPCs();
-    void movementThread();
-    void combatThread();
-    void printMapThread();
-    
-    void processCombat(std::shared_ptr<NPC> attacker, std::shared_ptr<NPC> defender);
+    void simulationTick();
+    uint32_t movementTick();
+    uint32_t combatTick(uint32_t tick);
+    void scheduleReport();
+    void reportEvents();
+    void renderMap();
+    void publishFrame();
     
-    std::vector<std::shared_ptr<NPC>> npcs;
-    mutable std::shared_mutex npcsMutex;
+    WorldConfig config;
     
-    ThreadSafeQueue combatQueue;
-    std::map<std::pair<int, int>, std::shared_ptr<NPC>> positionMap;
-    mutable std::mutex positionMapMutex;
+    // world и positionMap меняет только задача тика (tickInFlight не дает
+    // запустить два тика сразу); остальные задачи читают опубликованный кадр
+    NPCWorld world;
+    SparseGrid positionMap;  // хэндлы живых NPC по непустым чанкам карты
+    FramePublisher frames;
+    MapRenderer mapRenderer;  // только задача кадра (frameInFlight)
     
     std::atomic<bool> running{false};
     std::mutex coutMutex;
     
-    std::thread movementWorker;
-    std::thread combatWorker;
-    std::thread printWorker;
+    std::atomic<bool> tickInFlight{false};
+    std::atomic<bool> frameInFlight{false};
+    std::atomic<bool> reportInFlight{false};
+    // Сбрасывает флаг задачи и будит stop(), который ждет все три флага
+    void finishTask(std::atomic<bool>& inFlight);
+    std::mutex inFlightMutex;
+    std::condition_variable inFlightDone;
+    
+    uint64_t seed;
+    double tickRate;
+    uint64_t moveSeed;        // seed счетчикового генератора шагов
+    uint32_t moveTick = 0;
+    
+    TiledCombat tiledCombat;
+    uint32_t combatKey;       // ключ бросков кубика в бою
+    
+    // Задача тика пишет события в шину, отдельная задача доставляет их наблюдателям
+    Observable events;
+    
+    TickProfiler profiler;
+    std::string metricsPath;
+    std::chrono::milliseconds metricsInterval{1000};
     
-    std::mt19937 randomEngine;
+    void removeDeadNPC(NPCHandle npc);
     
-    void updatePosition(std::shared_ptr<NPC> npc, int oldX, int oldY, int newX, int newY);
-    void removeDeadNPC(std::shared_ptr<NPC> npc);
+    // Объявлен последним: разрушается первым и дожидается задач,
+    // которые обращаются к остальным полям
+    ThreadPool executor;
 };
 
 #endif
\ No newline at end of file
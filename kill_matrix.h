@@ -0,0 +1,94 @@
+#ifndef KILL_MATRIX_H
+#define KILL_MATRIX_H
+
+#include "npc.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Правила боя: при добавлении типа NPC здесь правятся только правила
+// (остальное - см. NPCType). Полнота проверяется при компиляции.
+struct KillRule {
+    NPCType killer;
+    NPCType victim;
+};
+
+inline constexpr KillRule KILL_RULES[] = {
+    {NPCType::Werewolf, NPCType::Rogue},    // Оборотни убивают разбойников
+    {NPCType::Rogue, NPCType::Bear},        // Разбойники убивают медведей
+    {NPCType::Bear, NPCType::Werewolf},     // Медведи убивают оборотней
+};
+
+// Исход встречи a и b одним табличным чтением: бит 0 - a может убить b,
+// бит 1 - b может убить a
+enum FightOutcome : uint8_t {
+    FIGHT_NONE = 0,
+    FIGHT_A_KILLS = 1,
+    FIGHT_B_KILLS = 2,
+    FIGHT_MUTUAL = 3
+};
+
+using KillMatrix = std::array<std::array<uint8_t, NPC_TYPE_COUNT>, NPC_TYPE_COUNT>;
+
+constexpr KillMatrix makeFightOutcomes() {
+    KillMatrix outcomes{};
+    for (const KillRule& rule : KILL_RULES) {
+        auto killer = static_cast<size_t>(rule.killer);
+        auto victim = static_cast<size_t>(rule.victim);
+        outcomes[killer][victim] |= FIGHT_A_KILLS;
+        outcomes[victim][killer] |= FIGHT_B_KILLS;
+    }
+    return outcomes;
+}
+
+inline constexpr KillMatrix FIGHT_OUTCOMES = makeFightOutcomes();
+
+constexpr uint8_t fightOutcome(NPCType a, NPCType b) {
+    return FIGHT_OUTCOMES[static_cast<size_t>(a)][static_cast<size_t>(b)];
+}
+
+constexpr bool canKill(NPCType killer, NPCType victim) {
+    return (fightOutcome(killer, victim) & FIGHT_A_KILLS) != 0;
+}
+
+namespace kill_matrix_detail {
+
+constexpr bool rulesInRange() {
+    for (const KillRule& rule : KILL_RULES) {
+        if (static_cast<size_t>(rule.killer) >= NPC_TYPE_COUNT ||
+            static_cast<size_t>(rule.victim) >= NPC_TYPE_COUNT) return false;
+    }
+    return true;
+}
+
+constexpr bool noSelfKills() {
+    for (const KillRule& rule : KILL_RULES) {
+        if (rule.killer == rule.victim) return false;
+    }
+    return true;
+}
+
+// У каждого типа есть и добыча, и хищник: новый тип без правил не скомпилируется
+constexpr bool everyTypeFights() {
+    for (size_t t = 0; t < NPC_TYPE_COUNT; ++t) {
+        bool hunts = false;
+        bool hunted = false;
+        for (size_t other = 0; other < NPC_TYPE_COUNT; ++other) {
+            hunts = hunts || (FIGHT_OUTCOMES[t][other] & FIGHT_A_KILLS);
+            hunted = hunted || (FIGHT_OUTCOMES[t][other] & FIGHT_B_KILLS);
+        }
+        if (!hunts || !hunted) return false;
+    }
+    return true;
+}
+
+}
+
+static_assert(kill_matrix_detail::rulesInRange(), "KILL_RULES references an unknown NPCType");
+static_assert(kill_matrix_detail::noSelfKills(), "NPCs of the same type do not fight");
+static_assert(kill_matrix_detail::everyTypeFights(), "every NPCType needs a prey and a predator in KILL_RULES");
+
+static_assert(canKill(NPCType::Werewolf, NPCType::Rogue) && !canKill(NPCType::Rogue, NPCType::Werewolf),
+              "kill matrix orientation");
+
+#endif
@@ -1,10 +1,65 @@
 #include "game_engine.h"
+#include "game_constants.h"
+#include <stdexcept>
+#include <string>
+#include <chrono>
 #include <iostream>
 
-int main() {
+int main(int argc, char** argv) {
     try {
-        GameEngine engine;
-        engine.run();
+        // editor [seed] [--config file] [--set key=value]... [--headless ticks] [--tick-rate hz] [--ansi]
+        //        [--metrics file.json|file.csv|file.prom] [--metrics-interval ms]
+        // Ключи --set и файла конфигурации - как у WorldConfig::set; --metrics
+        // требует сборки с RPG_PROFILING
+        uint64_t seed = GameEngine::randomSeed();
+        uint32_t headlessTicks = 0;
+        WorldConfig config;
+        RenderMode renderMode = RenderMode::Plain;
+        std::string metricsPath;
+        long metricsIntervalMs = 1000;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--config" && i + 1 < argc) {
+                config = WorldConfig::fromFile(argv[++i]);
+            } else if (arg == "--set" && i + 1 < argc) {
+                std::string setting = argv[++i];
+                size_t eq = setting.find('=');
+                if (eq == std::string::npos) {
+                    throw std::runtime_error("Expected --set key=value, got: " + setting);
+                }
+                config.set(setting.substr(0, eq), setting.substr(eq + 1));
+            } else if (arg == "--headless" && i + 1 < argc) {
+                headlessTicks = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (arg == "--tick-rate" && i + 1 < argc) {
+                config.tickRate = std::stod(argv[++i]);
+            } else if (arg == "--metrics" && i + 1 < argc) {
+                metricsPath = argv[++i];
+            } else if (arg == "--metrics-interval" && i + 1 < argc) {
+                metricsIntervalMs = std::stol(argv[++i]);
+            } else if (arg == "--ansi") {
+                renderMode = RenderMode::Ansi;
+            } else {
+                seed = std::stoull(arg);
+            }
+        }
+        
+        GameEngine engine(config, seed);
+        engine.setRenderMode(renderMode);
+        if (!metricsPath.empty()) {
+            engine.setMetricsOutput(metricsPath, std::chrono::milliseconds(metricsIntervalMs));
+        }
+        
+        if (headlessTicks > 0) {
+            std::cout << "Seed: " << seed << std::endl;
+            StepStats stats = engine.step(headlessTicks);
+            engine.stop();
+            engine.exportMetrics();
+            engine.printSurvivors();
+            std::cout << "Headless: " << stats.ticks << " ticks in " << stats.seconds << " s ("
+                      << stats.ticksPerSecond << " ticks/s)" << std::endl;
+        } else {
+            engine.run();
+        }
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
@@ -0,0 +1,216 @@
+#include "map_renderer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+
+namespace {
+
+constexpr char EMPTY_CELL = '.';
+constexpr std::string_view MAP_TITLE = "=== CURRENT MAP ===";
+
+// "Legend: B=Bear, W=Werewolf, R=Rogue, .=empty" по таблице NPC_TYPES
+const std::string& legend() {
+    static const std::string text = [] {
+        std::string line = "Legend: ";
+        for (const NPCTypeInfo& info : NPC_TYPES) {
+            line += info.symbol;
+            line += '=';
+            line += info.token;
+            line += ", ";
+        }
+        line += EMPTY_CELL;
+        line += "=empty";
+        return line;
+    }();
+    return text;
+}
+
+// Строки экрана в режиме Ansi (с 1): заголовок, карта, легенда, статус, дальше прокрутка
+constexpr int MAP_FIRST_ROW = 2;
+
+int ceilDiv(int a, int b) {
+    return (a + b - 1) / b;
+}
+
+}
+
+MapRenderer::MapRenderer(int mapWidth, int mapHeight, int maxViewWidth, int maxViewHeight, RenderMode mode)
+    : mapWidth(mapWidth), mapHeight(mapHeight), mode(mode) {
+    if (mapWidth <= 0 || mapHeight <= 0 || maxViewWidth <= 0 || maxViewHeight <= 0) {
+        throw std::runtime_error("Map and view sizes must be positive");
+    }
+    scaleW = ceilDiv(mapWidth, maxViewWidth);
+    scaleH = ceilDiv(mapHeight, maxViewHeight);
+    viewW = ceilDiv(mapWidth, scaleW);
+    viewH = ceilDiv(mapHeight, scaleH);
+
+    size_t area = static_cast<size_t>(viewW) * viewH;
+    cells.assign(area, EMPTY_CELL);
+    previous.assign(area, EMPTY_CELL);
+    counts.assign(area * NPC_TYPE_COUNT, 0);
+    // Полный кадр с управляющими последовательностями с запасом; дальше без выделений
+    out.reserve(area * 2 + static_cast<size_t>(viewH) * 16 + 256);
+}
+
+std::string_view MapRenderer::render(const WorldFrame& frame) {
+    auto start = std::chrono::steady_clock::now();
+    rasterize(frame);
+    out.clear();
+    if (mode == RenderMode::Plain || !screenValid) {
+        writeFull();
+    } else {
+        writeDelta();
+    }
+    previous.swap(cells);
+    renderMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    writeStatus(frame, renderMs);
+    return out;
+}
+
+void MapRenderer::invalidate() {
+    screenValid = false;
+}
+
+std::string_view MapRenderer::finish() {
+    out.clear();
+    if (mode == RenderMode::Ansi && screenValid) {
+        // Снимаем область прокрутки и уводим курсор вниз, под карту
+        out += "\x1b[r\x1b[999;1H\n";
+        screenValid = false;
+    }
+    return out;
+}
+
+RenderMode MapRenderer::getMode() const {
+    return mode;
+}
+
+int MapRenderer::viewWidth() const {
+    return viewW;
+}
+
+int MapRenderer::viewHeight() const {
+    return viewH;
+}
+
+int MapRenderer::scaleX() const {
+    return scaleW;
+}
+
+int MapRenderer::scaleY() const {
+    return scaleH;
+}
+
+double MapRenderer::lastRenderMs() const {
+    return renderMs;
+}
+
+size_t MapRenderer::lastChangedCells() const {
+    return changedCells;
+}
+
+void MapRenderer::rasterize(const WorldFrame& frame) {
+    std::fill(counts.begin(), counts.end(), 0u);
+    for (size_t i = 0; i < frame.size(); ++i) {
+        int x = frame.x[i];
+        int y = frame.y[i];
+        if (x < 0 || x >= mapWidth || y < 0 || y >= mapHeight) continue;
+        size_t cell = static_cast<size_t>(y / scaleH) * viewW + x / scaleW;
+        counts[cell * NPC_TYPE_COUNT + static_cast<size_t>(frame.type[i])]++;
+    }
+
+    // Больше всего NPC какого типа, при равенстве - первый по порядку типов
+    for (size_t cell = 0; cell < cells.size(); ++cell) {
+        const uint32_t* c = &counts[cell * NPC_TYPE_COUNT];
+        size_t best = 0;
+        for (size_t t = 1; t < NPC_TYPE_COUNT; ++t) {
+            if (c[t] > c[best]) best = t;
+        }
+        cells[cell] = c[best] > 0 ? NPC_TYPES[best].symbol : EMPTY_CELL;
+    }
+}
+
+void MapRenderer::writeFull() {
+    if (mode == RenderMode::Ansi) {
+        out += "\x1b[2J\x1b[H";
+    } else {
+        out += '\n';
+    }
+    out += MAP_TITLE;
+    out += '\n';
+    for (int y = 0; y < viewH; ++y) {
+        out.append(&cells[static_cast<size_t>(y) * viewW], viewW);
+        out += '\n';
+    }
+    out += legend();
+    out += '\n';
+    changedCells = cells.size();
+
+    if (mode == RenderMode::Ansi) {
+        // Строка статуса остается над областью прокрутки
+        int scrollTop = MAP_FIRST_ROW + viewH + 2;
+        char region[32];
+        int n = std::snprintf(region, sizeof(region), "\x1b[%dr", scrollTop);
+        out.append(region, n);
+        moveCursor(scrollTop, 1);
+        screenValid = true;
+    }
+}
+
+void MapRenderer::writeDelta() {
+    changedCells = 0;
+    for (size_t cell = 0; cell < cells.size(); ++cell) {
+        changedCells += cells[cell] != previous[cell];
+    }
+
+    out += "\x1b" "7";  // сохранить курсор в области сообщений
+    if (changedCells * 2 > cells.size()) {
+        // Изменилась большая часть - дешевле переписать строки подряд
+        for (int y = 0; y < viewH; ++y) {
+            moveCursor(MAP_FIRST_ROW + y, 1);
+            out.append(&cells[static_cast<size_t>(y) * viewW], viewW);
+        }
+    } else if (changedCells > 0) {
+        // Соседние изменившиеся клетки строки пишутся одним прогоном
+        for (int y = 0; y < viewH; ++y) {
+            size_t rowStart = static_cast<size_t>(y) * viewW;
+            int lastWritten = -2;
+            for (int x = 0; x < viewW; ++x) {
+                size_t cell = rowStart + x;
+                if (cells[cell] == previous[cell]) continue;
+                if (x != lastWritten + 1) {
+                    moveCursor(MAP_FIRST_ROW + y, x + 1);
+                }
+                out += cells[cell];
+                lastWritten = x;
+            }
+        }
+    }
+    out += "\x1b" "8";
+}
+
+void MapRenderer::writeStatus(const WorldFrame& frame, double ms) {
+    char status[128];
+    int n = std::snprintf(status, sizeof(status), "Tick %u, %zu alive, frame %.3f ms", frame.tick, frame.size(), ms);
+    if (scaleW > 1 || scaleH > 1) {
+        n += std::snprintf(status + n, sizeof(status) - n, ", 1 char = %dx%d cells", scaleW, scaleH);
+    }
+
+    if (mode == RenderMode::Ansi) {
+        out += "\x1b" "7";
+        moveCursor(MAP_FIRST_ROW + viewH + 1, 1);
+        out += "\x1b[2K";
+        out.append(status, n);
+        out += "\x1b" "8";
+    } else {
+        out.append(status, n);
+        out += '\n';
+    }
+}
+
+void MapRenderer::moveCursor(int row, int column) {
+    char seq[24];
+    int n = std::snprintf(seq, sizeof(seq), "\x1b[%d;%dH", row, column);
+    out.append(seq, n);
+}
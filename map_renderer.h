@@ -0,0 +1,71 @@
+#ifndef MAP_RENDERER_H
+#define MAP_RENDERER_H
+
+#include "world_frame.h"
+#include "game_constants.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class RenderMode {
+    Plain,  // каждый кадр целиком, как обычный текст в потоке вывода
+    Ansi    // карта закреплена вверху терминала, перерисовываются только изменения
+};
+
+// Рисует кадр мира в один заранее выделенный буфер, который выводится
+// одной записью. Карта больше окна уменьшается: символ клетки окна -
+// тип, которого больше всего в покрываемом ею прямоугольнике карты.
+//
+// В режиме Ansi первый кадр очищает экран и задает область прокрутки под
+// картой (туда уходят сообщения об убийствах); следующие кадры переставляют
+// курсор только к изменившимся клеткам и возвращают его на место.
+class MapRenderer {
+public:
+    MapRenderer(int mapWidth, int mapHeight,
+                int maxViewWidth = MAP_VIEW_MAX_WIDTH, int maxViewHeight = MAP_VIEW_MAX_HEIGHT,
+                RenderMode mode = RenderMode::Plain);
+
+    // Байты для вывода; действительны до следующего вызова render/finish
+    std::string_view render(const WorldFrame& frame);
+    // Следующий render в режиме Ansi перерисует экран целиком
+    void invalidate();
+    // Ansi: возвращает терминалу всю область прокрутки; Plain: пусто
+    std::string_view finish();
+
+    RenderMode getMode() const;
+    int viewWidth() const;
+    int viewHeight() const;
+    // Клеток карты на один символ по горизонтали и вертикали
+    int scaleX() const;
+    int scaleY() const;
+
+    double lastRenderMs() const;
+    // Клетки окна, изменившиеся в последнем кадре (все - при полной перерисовке)
+    size_t lastChangedCells() const;
+
+private:
+    void rasterize(const WorldFrame& frame);
+    void writeFull();
+    void writeDelta();
+    void writeStatus(const WorldFrame& frame, double ms);
+    void moveCursor(int row, int column);
+
+    int mapWidth;
+    int mapHeight;
+    int scaleW;
+    int scaleH;
+    int viewW;
+    int viewH;
+    RenderMode mode;
+
+    std::vector<char> cells;      // текущий кадр, viewW * viewH
+    std::vector<char> previous;   // то, что уже на экране (Ansi)
+    std::vector<uint32_t> counts; // NPC каждого типа по клеткам окна
+    std::string out;
+    bool screenValid = false;
+    double renderMs = 0.0;
+    size_t changedCells = 0;
+};
+
+#endif
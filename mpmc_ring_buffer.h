@@ -0,0 +1,100 @@
+#ifndef MPMC_RING_BUFFER_H
+#define MPMC_RING_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Ограниченная lock-free очередь для многих производителей и потребителей
+// (кольцевой буфер Д. Вьюкова). Каждая ячейка хранит номер последовательности:
+// по нему производитель видит, что ячейка свободна, а потребитель - что
+// она заполнена. Предназначена для мелких POD-записей вместо std::function.
+//
+// Движок ее не использует: события идут пачками через потоковые буферы
+// Observable. Очередь осталась для сравнения в rpg_bench (queue/*) и в тестах.
+template <typename T>
+class MPMCRingBuffer {
+public:
+    // Емкость округляется вверх до степени двойки (не меньше 2)
+    explicit MPMCRingBuffer(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        mask_ = size - 1;
+        cells_ = std::make_unique<Cell[]>(size);
+        for (size_t i = 0; i < size; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    
+    MPMCRingBuffer(const MPMCRingBuffer&) = delete;
+    MPMCRingBuffer& operator=(const MPMCRingBuffer&) = delete;
+    
+    // false, если очередь заполнена
+    bool tryPush(const T& value) {
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = value;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // false, если очередь пуста
+    bool tryPop(T& value) {
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->value);
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+    
+    size_t capacity() const {
+        return mask_ + 1;
+    }
+    
+    // Приблизительный размер: при одновременных операциях может устареть
+    size_t sizeApprox() const {
+        size_t head = dequeuePos_.load(std::memory_order_relaxed);
+        size_t tail = enqueuePos_.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+    
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+    
+    static constexpr size_t CACHE_LINE = 64;
+    
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    alignas(CACHE_LINE) std::atomic<size_t> enqueuePos_{0};
+    alignas(CACHE_LINE) std::atomic<size_t> dequeuePos_{0};
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "name_table.h"
+#include <mutex>
+#include <stdexcept>
+
+NameTable& NameTable::global() {
+    static NameTable table;
+    return table;
+}
+
+NameId NameTable::intern(std::string_view name) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = ids.find(name);
+        if (it != ids.end()) return it->second;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    return internLocked(name);
+}
+
+NameId NameTable::internLocked(std::string_view name) {
+    auto it = ids.find(name);
+    if (it != ids.end()) return it->second;
+
+    if (names.size() >= UINT32_MAX) {
+        throw std::runtime_error("NameTable is full");
+    }
+    NameId id = static_cast<NameId>(names.size());
+    const std::string& stored = names.emplace_back(name);
+    if (stored.capacity() > std::string().capacity()) {
+        heapBytes += stored.capacity() + 1;  // буфер вне SSO
+    }
+    ids.emplace(std::string_view(stored), id);
+    return id;
+}
+
+void NameTable::intern(const std::string_view* batch, size_t count, NameId* out) {
+    constexpr NameId MISSING = UINT32_MAX;  // не выдается: размер таблицы < UINT32_MAX
+    size_t missing = 0;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        for (size_t i = 0; i < count; ++i) {
+            auto it = ids.find(batch[i]);
+            out[i] = it != ids.end() ? it->second : MISSING;
+            missing += out[i] == MISSING;
+        }
+    }
+    if (missing == 0) return;
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    for (size_t i = 0; i < count; ++i) {
+        if (out[i] == MISSING) out[i] = internLocked(batch[i]);
+    }
+}
+
+const std::string& NameTable::resolve(NameId id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return names.at(id);
+}
+
+size_t NameTable::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return names.size();
+}
+
+size_t NameTable::memoryUsage() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    // Узел хэш-таблицы: ключ, значение и указатель на следующий узел (+ хэш в libstdc++)
+    const size_t node = sizeof(std::string_view) + sizeof(NameId) + 2 * sizeof(void*);
+    return names.size() * (sizeof(std::string) + node) + ids.bucket_count() * sizeof(void*) + heapBytes;
+}
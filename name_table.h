@@ -0,0 +1,44 @@
+#ifndef NAME_TABLE_H
+#define NAME_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+using NameId = uint32_t;
+
+// Таблица интернированных имен: каждое различное имя хранится один раз,
+// NPC держат только 32-битный идентификатор. Строка нужна лишь при выводе
+// (консоль, лог, сохранение). Таблица общая для фабрики, редактора и движка,
+// потокобезопасна и не сжимается: идентификаторы действительны до конца процесса.
+class NameTable {
+public:
+    static NameTable& global();
+
+    NameId intern(std::string_view name);
+    // out[i] = intern(batch[i]): поиск под одной разделяемой блокировкой,
+    // новые имена - под одной исключительной. Для пакетов из параллельных
+    // задач, которые иначе стояли бы в очереди на блокировку по имени.
+    void intern(const std::string_view* batch, size_t count, NameId* out);
+    // Ссылка остается действительной и после добавления новых имен
+    const std::string& resolve(NameId id) const;
+
+    size_t size() const;
+    // Примерный объем памяти таблицы в байтах (строки, их буферы и индекс)
+    size_t memoryUsage() const;
+
+private:
+    // Под исключительной блокировкой
+    NameId internLocked(std::string_view name);
+
+    mutable std::shared_mutex mutex;
+    std::deque<std::string> names;
+    std::unordered_map<std::string_view, NameId> ids;  // ключи указывают в names
+    size_t heapBytes = 0;
+};
+
+#endif
@@ -5,7 +5,11 @@
 #include <algorithm>
 
 NPC::NPC(NPCType type, int x, int y, const std::string& name)
-    : type(type), x(x), y(y), name(name), alive(true), randomEngine(nullptr) {
+    : NPC(type, x, y, NameTable::global().intern(name)) {
+}
+
+NPC::NPC(NPCType type, int x, int y, NameId nameId)
+    : type(type), x(x), y(y), nameId(nameId), alive(true), randomEngine(nullptr), hasStream(false) {
 }
 
 NPCType NPC::getType() const {
@@ -21,12 +25,16 @@ int NPC::getY() const {
 }
 
 void NPC::setPosition(int newX, int newY) {
-    x = std::max(0, std::min(MAP_WIDTH - 1, newX));
-    y = std::max(0, std::min(MAP_HEIGHT - 1, newY));
+    x = newX;
+    y = newY;
 }
 
 const std::string& NPC::getName() const {
-    return name;
+    return NameTable::global().resolve(nameId);
+}
+
+NameId NPC::getNameId() const {
+    return nameId;
 }
 
 bool NPC::isAlive() const {
@@ -37,12 +45,18 @@ void NPC::markDead() {
     alive = false;
 }
 
-void NPC::move(int maxX, int maxY) {
-    if (!alive || !randomEngine) return;
+void NPC::move(int maxX, int maxY, int distance) {
+    if (!alive || (!randomEngine && !hasStream)) return;
     
-    std::uniform_int_distribution<int> dirDist(-MOVE_DISTANCE, MOVE_DISTANCE);
-    int newX = x + dirDist(*randomEngine);
-    int newY = y + dirDist(*randomEngine);
+    int newX, newY;
+    if (hasStream) {
+        newX = x + stream.uniformInt(-distance, distance);
+        newY = y + stream.uniformInt(-distance, distance);
+    } else {
+        std::uniform_int_distribution<int> dirDist(-distance, distance);
+        newX = x + dirDist(*randomEngine);
+        newY = y + dirDist(*randomEngine);
+    }
     
     newX = std::max(0, std::min(maxX - 1, newX));
     newY = std::max(0, std::min(maxY - 1, newY));
@@ -51,13 +65,14 @@ void NPC::move(int maxX, int maxY) {
 }
 
 int NPC::rollDice() {
+    if (hasStream) return stream.uniformInt(1, 6);
     if (!randomEngine) return 0;
     std::uniform_int_distribution<int> dice(1, 6);
     return dice(*randomEngine);
 }
 
 bool NPC::tryKill(NPC& other) {
-    if (!randomEngine) return false;
+    if (!randomEngine && !hasStream) return false;
     
     int attack = rollDice();
     int defense = other.rollDice();
@@ -67,28 +82,20 @@ bool NPC::tryKill(NPC& other) {
 
 void NPC::setRandomEngine(std::mt19937& engine) {
     randomEngine = &engine;
+    hasStream = false;
 }
 
-Bear::Bear(int x, int y, const std::string& name)
-    : NPC(NPCType::Bear, x, y, name) {
-}
-
-void Bear::accept(NPCVisitor& visitor) {
-    visitor.visit(*this);
-}
-
-Werewolf::Werewolf(int x, int y, const std::string& name)
-    : NPC(NPCType::Werewolf, x, y, name) {
-}
-
-void Werewolf::accept(NPCVisitor& visitor) {
-    visitor.visit(*this);
+void NPC::setRandomStream(const RngStream& newStream) {
+    stream = newStream;
+    hasStream = true;
+    randomEngine = nullptr;
 }
 
-Rogue::Rogue(int x, int y, const std::string& name)
-    : NPC(NPCType::Rogue, x, y, name) {
+template <typename Derived, NPCType Kind>
+void NPCKind<Derived, Kind>::accept(NPCVisitor& visitor) {
+    visitor.visit(static_cast<Derived&>(*this));
 }
 
-void Rogue::accept(NPCVisitor& visitor) {
-    visitor.visit(*this);
-}
\ No newline at end of file
+template class NPCKind<Bear, NPCType::Bear>;
+template class NPCKind<Werewolf, NPCType::Werewolf>;
+template class NPCKind<Rogue, NPCType::Rogue>;
\ No newline at end of file
@@ -1,23 +1,84 @@
 #ifndef NPC_H
 #define NPC_H
 
+#include <cstddef>
 #include <string>
+#include <string_view>
 #include <memory>
 #include <vector>
 #include <random>
 #include <mutex>  // Добавьте
+#include "rng_stream.h"
+#include "name_table.h"
+#include "game_constants.h"
 
+// Новый тип: значение здесь, строка в NPC_TYPES, класс NPCKind ниже
+// (с NPCVisitor::visit и строкой в фабрике) и правила в KILL_RULES
 enum class NPCType {
     Bear,
     Werewolf,  // Изменено с Elf на Werewolf
     Rogue
 };
 
+// Свойства типа для текстового формата, вывода и карты
+struct NPCTypeInfo {
+    NPCType type;
+    std::string_view token;  // в файле подземелья и при выводе
+    char symbol;             // на карте
+};
+
+// Строки в порядке NPCType: таблица индексируется значением типа
+inline constexpr NPCTypeInfo NPC_TYPES[] = {
+    {NPCType::Bear, "Bear", 'B'},
+    {NPCType::Werewolf, "Werewolf", 'W'},
+    {NPCType::Rogue, "Rogue", 'R'},
+};
+
+// Число типов NPC: размер таблиц, индексируемых NPCType (см. kill_matrix.h)
+constexpr size_t NPC_TYPE_COUNT = sizeof(NPC_TYPES) / sizeof(NPC_TYPES[0]);
+
+namespace npc_type_detail {
+
+constexpr bool rowsInEnumOrder() {
+    for (size_t t = 0; t < NPC_TYPE_COUNT; ++t) {
+        if (static_cast<size_t>(NPC_TYPES[t].type) != t) return false;
+    }
+    return true;
+}
+
+}
+
+static_assert(npc_type_detail::rowsInEnumOrder(), "NPC_TYPES rows must follow NPCType order");
+
+// Сырое значение из файла (снимок, журнал) - известный тип
+constexpr bool isNPCType(unsigned raw) {
+    return raw < NPC_TYPE_COUNT;
+}
+
+constexpr const NPCTypeInfo& npcTypeInfo(NPCType type) {
+    return NPC_TYPES[static_cast<size_t>(type)];
+}
+
+constexpr std::string_view npcTypeToken(NPCType type) {
+    return isNPCType(static_cast<unsigned>(type)) ? npcTypeInfo(type).token : std::string_view("Unknown");
+}
+
+constexpr bool npcTypeFromToken(std::string_view token, NPCType& type) {
+    for (const NPCTypeInfo& info : NPC_TYPES) {
+        if (info.token == token) {
+            type = info.type;
+            return true;
+        }
+    }
+    return false;
+}
+
 class NPCVisitor;
 
 class NPC {
 public:
     NPC(NPCType type, int x, int y, const std::string& name);
+    NPC(NPCType type, int x, int y, NameId nameId);
     virtual ~NPC() = default;
     
     virtual void accept(NPCVisitor& visitor) = 0;
@@ -25,41 +86,59 @@ public:
     NPCType getType() const;
     int getX() const;
     int getY() const;
+    // Без ограничения картой: границы проверяют редактор и move
     void setPosition(int newX, int newY);
+    // Имя из NameTable; для горячих путей сравнивать и копировать getNameId
     const std::string& getName() const;
+    NameId getNameId() const;
     bool isAlive() const;
     void markDead();
     
-    void move(int maxX, int maxY);
+    void move(int maxX, int maxY, int distance = MOVE_DISTANCE);
     int rollDice();
     bool tryKill(NPC& other);
+    // Общий генератор: удобно в тестах, но небезопасно из нескольких потоков
     void setRandomEngine(std::mt19937& engine);
+    // Собственный поток NPC: независим от остальных и воспроизводим по seed
+    void setRandomStream(const RngStream& stream);
 
 private:
     NPCType type;
     int x;
     int y;
-    std::string name;
+    NameId nameId;
     bool alive;
     std::mt19937* randomEngine;
+    RngStream stream;
+    bool hasStream;
+};
+
+// Общая часть конкретных типов: тип известен при компиляции, accept
+// написан один раз и вызывает visit с точным типом без приведения
+template <typename Derived, NPCType Kind>
+class NPCKind : public NPC {
+public:
+    static constexpr NPCType TYPE = Kind;
+
+    NPCKind(int x, int y, const std::string& name) : NPC(Kind, x, y, name) {}
+    NPCKind(int x, int y, NameId nameId) : NPC(Kind, x, y, nameId) {}
+
+    void accept(NPCVisitor& visitor) final;
 };
 
-class Bear : public NPC {
+class Bear final : public NPCKind<Bear, NPCType::Bear> {
 public:
-    Bear(int x, int y, const std::string& name);
-    void accept(NPCVisitor& visitor) override;
+    using NPCKind::NPCKind;
 };
 
-class Werewolf : public NPC {  // Изменено с Elf на Werewolf
+class Werewolf final : public NPCKind<Werewolf, NPCType::Werewolf> {  // Изменено с Elf на Werewolf
 public:
-    Werewolf(int x, int y, const std::string& name);
-    void accept(NPCVisitor& visitor) override;
+    using NPCKind::NPCKind;
 };
 
-class Rogue : public NPC {
+class Rogue final : public NPCKind<Rogue, NPCType::Rogue> {
 public:
-    Rogue(int x, int y, const std::string& name);
-    void accept(NPCVisitor& visitor) override;
+    using NPCKind::NPCKind;
 };
 
 #endif
\ No newline at end of file
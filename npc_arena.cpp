@@ -0,0 +1,91 @@
+#include "npc_arena.h"
+#include <stdexcept>
+
+// Слябы выровнены на max_align_t, размеры блоков кратны GRANULE
+static_assert(NPCArena::GRANULE % alignof(std::max_align_t) == 0, "GRANULE must keep blocks aligned");
+
+NPCArena::NPCArena(size_t blocksPerSlab)
+    : blocksPerSlab(blocksPerSlab ? blocksPerSlab : 1) {
+}
+
+NPCArena::~NPCArena() {
+    for (void* slab : slabs) {
+        ::operator delete(slab);
+    }
+}
+
+size_t NPCArena::classIndex(size_t bytes) {
+    return (bytes + GRANULE - 1) / GRANULE - 1;
+}
+
+void* NPCArena::allocate(size_t bytes) {
+    if (bytes == 0 || bytes > MAX_BLOCK) {
+        return ::operator new(bytes);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    SizeClass& sizeClass = classes[classIndex(bytes)];
+    live++;
+
+    if (sizeClass.freeList) {
+        FreeBlock* block = sizeClass.freeList;
+        sizeClass.freeList = block->next;
+        sizeClass.freeCount--;
+        return block;
+    }
+
+    const size_t blockSize = (classIndex(bytes) + 1) * GRANULE;
+    if (sizeClass.bump == sizeClass.bumpEnd) {
+        const size_t slabBytes = blockSize * blocksPerSlab;
+        char* slab = static_cast<char*>(::operator new(slabBytes));
+        slabs.push_back(slab);
+        reserved += slabBytes;
+        sizeClass.bump = slab;
+        sizeClass.bumpEnd = slab + slabBytes;
+    }
+    void* block = sizeClass.bump;
+    sizeClass.bump += blockSize;
+    return block;
+}
+
+void NPCArena::deallocate(void* block, size_t bytes) {
+    if (bytes == 0 || bytes > MAX_BLOCK) {
+        ::operator delete(block);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    SizeClass& sizeClass = classes[classIndex(bytes)];
+    auto* freeBlock = static_cast<FreeBlock*>(block);
+    freeBlock->next = sizeClass.freeList;
+    sizeClass.freeList = freeBlock;
+    sizeClass.freeCount++;
+    live--;
+}
+
+void NPCArena::release() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (live != 0) {
+        throw std::runtime_error("NPCArena::release with " + std::to_string(live) + " live NPCs");
+    }
+    for (void* slab : slabs) {
+        ::operator delete(slab);
+    }
+    slabs.clear();
+    classes = {};
+    reserved = 0;
+}
+
+NPCArena::Stats NPCArena::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats stats{slabs.size(), reserved, live, 0};
+    for (const SizeClass& sizeClass : classes) {
+        stats.freeBlocks += sizeClass.freeCount;
+    }
+    return stats;
+}
+
+NPCArena& NPCArena::global() {
+    static NPCArena* arena = new NPCArena();
+    return *arena;
+}
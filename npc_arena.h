@@ -0,0 +1,95 @@
+#ifndef NPC_ARENA_H
+#define NPC_ARENA_H
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// Пул блоков для объектов NPC: блоки одного размерного класса нарезаются из
+// крупных слябов, освобожденные блоки (умершие NPC) возвращаются в
+// интрузивный список свободных и переиспользуются. Все слябы отдаются
+// системе разом в release() или деструкторе, без обхода отдельных NPC.
+class NPCArena {
+public:
+    struct Stats {
+        size_t slabs;
+        size_t reservedBytes;   // взято у системы
+        size_t liveBlocks;      // выдано и не возвращено
+        size_t freeBlocks;      // в списках свободных
+    };
+
+    explicit NPCArena(size_t blocksPerSlab = 4096);
+    ~NPCArena();
+
+    NPCArena(const NPCArena&) = delete;
+    NPCArena& operator=(const NPCArena&) = delete;
+
+    // Блоки больше MAX_BLOCK идут в обычную кучу
+    void* allocate(size_t bytes);
+    void deallocate(void* block, size_t bytes);
+
+    // Отдает все слябы за O(число слябов). Живых блоков быть не должно.
+    void release();
+
+    Stats getStats() const;
+
+    // Арена фабрики по умолчанию; не уничтожается до выхода из процесса,
+    // поэтому NPC в статических объектах остаются корректными
+    static NPCArena& global();
+
+    static constexpr size_t GRANULE = 16;
+    static constexpr size_t MAX_BLOCK = 256;
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct SizeClass {
+        FreeBlock* freeList = nullptr;
+        char* bump = nullptr;       // неразмеченный остаток текущего сляба
+        char* bumpEnd = nullptr;
+        size_t freeCount = 0;
+    };
+
+    static size_t classIndex(size_t bytes);
+
+    const size_t blocksPerSlab;
+    mutable std::mutex mutex;
+    std::array<SizeClass, MAX_BLOCK / GRANULE> classes;
+    std::vector<void*> slabs;
+    size_t reserved = 0;
+    size_t live = 0;
+};
+
+// Аллокатор для std::allocate_shared: объект NPC и счетчик ссылок лежат в
+// одном блоке арены
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(NPCArena& arena) : arena(&arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(arena->allocate(n * sizeof(T)));
+    }
+    void deallocate(T* block, size_t n) {
+        arena->deallocate(block, n * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+
+private:
+    template <typename U> friend class ArenaAllocator;
+    NPCArena* arena;
+};
+
+#endif
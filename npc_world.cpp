@@ -0,0 +1,209 @@
+#include "npc_world.h"
+#include "factory.h"
+#include "game_constants.h"
+#include "simd_kernels.h"
+#include "rng_stream.h"
+#include <algorithm>
+
+NPCHandle NPCWorld::spawn(NPCType npcType, int npcX, int npcY, const std::string& name) {
+    return spawn(npcType, npcX, npcY, NameTable::global().intern(name));
+}
+
+NPCHandle NPCWorld::spawn(NPCType npcType, int npcX, int npcY, NameId name) {
+    NPCHandle h = static_cast<NPCHandle>(slots.size());
+    slots.push_back(static_cast<uint32_t>(x.size()));
+    handleOf.push_back(h);
+    x.push_back(npcX);
+    y.push_back(npcY);
+    type.push_back(npcType);
+    alive.pushBack(true);
+    nameId.push_back(name);
+    liveCount++;
+    return h;
+}
+
+NPCHandle NPCWorld::spawn(const NPC& npc) {
+    NPCHandle h = spawn(npc.getType(), npc.getX(), npc.getY(), npc.getNameId());
+    if (!npc.isAlive()) {
+        markDead(h);
+    }
+    return h;
+}
+
+void NPCWorld::reserve(size_t count) {
+    x.reserve(count);
+    y.reserve(count);
+    type.reserve(count);
+    alive.reserve(count);
+    nameId.reserve(count);
+    handleOf.reserve(count);
+    slots.reserve(count);
+}
+
+void NPCWorld::clear() {
+    x.clear();
+    y.clear();
+    type.clear();
+    alive.clear();
+    nameId.clear();
+    handleOf.clear();
+    slots.clear();
+    liveCount = 0;
+}
+
+size_t NPCWorld::size() const {
+    return x.size();
+}
+
+size_t NPCWorld::aliveCount() const {
+    return liveCount;
+}
+
+size_t NPCWorld::handleCount() const {
+    return slots.size();
+}
+
+bool NPCWorld::contains(NPCHandle h) const {
+    return h < slots.size() && slots[h] != NO_SLOT;
+}
+
+NPCType NPCWorld::getType(NPCHandle h) const {
+    return type[slots[h]];
+}
+
+int NPCWorld::getX(NPCHandle h) const {
+    return x[slots[h]];
+}
+
+int NPCWorld::getY(NPCHandle h) const {
+    return y[slots[h]];
+}
+
+bool NPCWorld::isAlive(NPCHandle h) const {
+    return contains(h) && alive.test(slots[h]);
+}
+
+NameId NPCWorld::getNameId(NPCHandle h) const {
+    return nameId[h];
+}
+
+const std::string& NPCWorld::getName(NPCHandle h) const {
+    return NameTable::global().resolve(nameId[h]);
+}
+
+void NPCWorld::setPosition(NPCHandle h, int newX, int newY) {
+    uint32_t slot = slots[h];
+    x[slot] = newX;
+    y[slot] = newY;
+}
+
+void NPCWorld::markDead(NPCHandle h) {
+    if (!isAlive(h)) return;
+    alive.reset(slots[h]);
+    liveCount--;
+}
+
+size_t NPCWorld::compact() {
+    const size_t count = x.size();
+    // Хэндлы выброшенных слотов отсутствуют (до перезаписи handleOf)
+    for (size_t slot = 0; slot < count; ++slot) {
+        if (!alive.test(slot)) slots[handleOf[slot]] = NO_SLOT;
+    }
+
+    size_t out = 0;
+    alive.forEachSet([&](size_t slot) {
+        if (slot != out) {
+            x[out] = x[slot];
+            y[out] = y[slot];
+            type[out] = type[slot];
+            handleOf[out] = handleOf[slot];
+        }
+        out++;
+    });
+    for (size_t slot = 0; slot < out; ++slot) {
+        slots[handleOf[slot]] = static_cast<uint32_t>(slot);
+    }
+
+    x.resize(out);
+    y.resize(out);
+    type.resize(out);
+    handleOf.resize(out);
+    alive.clear();
+    for (size_t slot = 0; slot < out; ++slot) alive.pushBack(true);
+    return count - out;
+}
+
+size_t NPCWorld::compactIfSparse() {
+    return size() - liveCount > liveCount ? compact() : 0;
+}
+
+void NPCWorld::moveAll(std::mt19937& engine, int maxX, int maxY, int distance) {
+    std::uniform_int_distribution<int> dirDist(-distance, distance);
+    const int limitX = maxX - 1;
+    const int limitY = maxY - 1;
+
+    alive.forEachSet([&](size_t i) {
+        int newX = x[i] + dirDist(engine);
+        int newY = y[i] + dirDist(engine);
+        x[i] = std::max(0, std::min(limitX, newX));
+        y[i] = std::max(0, std::min(limitY, newY));
+    });
+}
+
+void NPCWorld::moveAllBatch(uint64_t streamSeed, uint32_t tick, int maxX, int maxY, int distance) {
+    const size_t count = x.size();
+    stepX.resize(count);
+    stepY.resize(count);
+    
+    // Внутри тика счетчик - номер слота, x и y - в разных половинах потока
+    const uint32_t tickKey = makeStreamKey(deriveSeed(streamSeed, tick));
+    randomSteps(tickKey, 0, stepX.data(), count, distance);
+    randomSteps(tickKey, static_cast<uint32_t>(count), stepY.data(), count, distance);
+    applyMoves(x.data(), y.data(), stepX.data(), stepY.data(), alive.data(), count, maxX, maxY);
+}
+
+std::shared_ptr<NPC> NPCWorld::toNPC(NPCHandle h) const {
+    uint32_t slot = slots[h];
+    auto npc = NPCFactory::create(type[slot], x[slot], y[slot], nameId[h]);
+    if (!alive.test(slot)) {
+        npc->markDead();
+    }
+    return npc;
+}
+
+std::vector<std::shared_ptr<NPC>> NPCWorld::toNPCs() const {
+    std::vector<std::shared_ptr<NPC>> result;
+    result.reserve(size());
+    for (NPCHandle h : handleOf) {
+        result.push_back(toNPC(h));
+    }
+    return result;
+}
+
+const NPCHandle* NPCWorld::handleData() const {
+    return handleOf.data();
+}
+
+const int32_t* NPCWorld::xData() const {
+    return x.data();
+}
+
+const int32_t* NPCWorld::yData() const {
+    return y.data();
+}
+
+const NPCType* NPCWorld::typeData() const {
+    return type.data();
+}
+
+const uint64_t* NPCWorld::aliveBits() const {
+    return alive.data();
+}
+
+uint32_t NPCWorld::slotOf(NPCHandle h) const {
+    return slots[h];
+}
+
+NPCHandle NPCWorld::handleAt(uint32_t slot) const {
+    return handleOf[slot];
+}
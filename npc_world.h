@@ -0,0 +1,110 @@
+#ifndef NPC_WORLD_H
+#define NPC_WORLD_H
+
+#include "npc.h"
+#include "alive_bitset.h"
+#include "game_constants.h"
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// Устойчивый идентификатор NPC внутри NPCWorld: не меняется при уплотнении
+using NPCHandle = uint32_t;
+constexpr NPCHandle INVALID_NPC_HANDLE = UINT32_MAX;
+
+// Хранилище NPC в виде структуры массивов: координаты, типы, флаги жизни и
+// идентификаторы имен лежат в отдельных непрерывных массивах, поэтому проход
+// движения или боя по миру - линейное чтение без указателей и счетчиков ссылок.
+// Классы NPC/Bear/Werewolf/Rogue остаются интерфейсом редактора: их можно
+// получить из мира через toNPC и добавить обратно через spawn. Это копии,
+// а не представления: NPC хранит координаты и флаг жизни в себе, а движок
+// отдает наружу кадры (WorldFrame), которые не должны меняться под читателем.
+// Изменения возвращаются в мир через setPosition/markDead по хэндлу.
+//
+// Массивы индексируются слотами; хэндл переводится в слот через таблицу.
+// compact() выбрасывает мертвых из массивов, сохраняя порядок живых, и
+// переписывает таблицу: хэндлы живых остаются действительными, хэндлы
+// выброшенных становятся "мертвыми и отсутствующими" (contains == false).
+class NPCWorld {
+public:
+    NPCHandle spawn(NPCType type, int x, int y, const std::string& name);
+    NPCHandle spawn(NPCType type, int x, int y, NameId name);
+    NPCHandle spawn(const NPC& npc);
+    void reserve(size_t count);
+    void clear();
+
+    // Число слотов в массивах (живые и еще не выброшенные мертвые)
+    size_t size() const;
+    size_t aliveCount() const;
+    // Число выданных хэндлов: хэндлы лежат в [0, handleCount())
+    size_t handleCount() const;
+    bool contains(NPCHandle h) const;
+
+    // Геттеры по хэндлу требуют contains(h); isAlive и имя доступны
+    // для любого выданного хэндла (отчеты об убийствах после уплотнения)
+    NPCType getType(NPCHandle h) const;
+    int getX(NPCHandle h) const;
+    int getY(NPCHandle h) const;
+    bool isAlive(NPCHandle h) const;
+    NameId getNameId(NPCHandle h) const;
+    const std::string& getName(NPCHandle h) const;
+
+    // Без ограничения картой: границы задает вызывающий (moveAll, WorldConfig)
+    void setPosition(NPCHandle h, int newX, int newY);
+    void markDead(NPCHandle h);
+
+    // fn(NPCHandle) для живых NPC в порядке слотов, по 64 флага за раз
+    template <typename Fn>
+    void forEachAlive(Fn&& fn) const {
+        alive.forEachSet([&](size_t slot) { fn(handleOf[slot]); });
+    }
+
+    // Убирает мертвых из массивов; возвращает число выброшенных
+    size_t compact();
+    // compact(), если мертвых слотов больше, чем живых
+    size_t compactIfSparse();
+
+    // Сдвигает всех живых NPC за один линейный проход.
+    // Последовательность случайных чисел такая же, как у NPC::move по порядку.
+    void moveAll(std::mt19937& engine, int maxX, int maxY, int distance = MOVE_DISTANCE);
+    // То же через пакетные SIMD-ядра и счетчиковый генератор:
+    // шаги тика tick зависят только от seed потока, tick и слота, поэтому
+    // прогон воспроизводим, пока уплотнение происходит в те же тики.
+    // Ключ генератора свой на каждый тик (из всех 64 бит seed), поэтому
+    // шаги не повторяются, сколько бы ни было тиков и NPC.
+    void moveAllBatch(uint64_t streamSeed, uint32_t tick, int maxX, int maxY, int distance = MOVE_DISTANCE);
+
+    // Отвязанные копии для API редактора (все слоты, с сохранением флага
+    // жизни); их изменения в мир не попадают
+    std::shared_ptr<NPC> toNPC(NPCHandle h) const;
+    std::vector<std::shared_ptr<NPC>> toNPCs() const;
+
+    // Прямой доступ к массивам для горячих циклов (индекс - слот)
+    const NPCHandle* handleData() const;
+    const int32_t* xData() const;
+    const int32_t* yData() const;
+    const NPCType* typeData() const;
+    const uint64_t* aliveBits() const;
+    uint32_t slotOf(NPCHandle h) const;
+    NPCHandle handleAt(uint32_t slot) const;
+
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+private:
+    std::vector<int32_t> x;
+    std::vector<int32_t> y;
+    std::vector<NPCType> type;
+    AliveBitset alive;
+    std::vector<NameId> nameId;  // по хэндлу, не уплотняется; имена в NameTable::global()
+
+    std::vector<NPCHandle> handleOf;  // слот -> хэндл
+    std::vector<uint32_t> slots;      // хэндл -> слот или NO_SLOT
+    size_t liveCount = 0;
+
+    std::vector<int32_t> stepX;  // буферы шагов для moveAllBatch
+    std::vector<int32_t> stepY;
+};
+
+#endif
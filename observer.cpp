@@ -4,38 +4,263 @@
 #include <ctime>
 #include <chrono>
 #include <iomanip>
+#include <algorithm>
+
+void Observer::onKills(Span<const KillEvent> kills) {
+    const NameTable& names = NameTable::global();
+    for (const KillEvent& kill : kills) {
+        onKill(names.resolve(kill.killerName), names.resolve(kill.victimName));
+        if (kill.mutual) {
+            onKill(names.resolve(kill.victimName), names.resolve(kill.killerName));
+        }
+    }
+}
 
 void ConsoleObserver::onKill(const std::string& killer, const std::string& victim) {
     std::cout << "[BATTLE] " << killer << " killed " << victim << std::endl;
 }
 
-FileObserver::FileObserver() {
+void ConsoleObserver::onKills(Span<const KillEvent> kills) {
+    const NameTable& names = NameTable::global();
+    buffer.clear();
+    for (const KillEvent& kill : kills) {
+        const std::string& killer = names.resolve(kill.killerName);
+        const std::string& victim = names.resolve(kill.victimName);
+        buffer += "[BATTLE] ";
+        buffer += killer;
+        buffer += " killed ";
+        buffer += victim;
+        buffer += '\n';
+        if (kill.mutual) {
+            buffer += "[BATTLE] ";
+            buffer += victim;
+            buffer += " killed ";
+            buffer += killer;
+            buffer += '\n';
+        }
+    }
+    std::cout.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    std::cout.flush();
+}
+
+FileObserver::FileObserver(const std::string& filename, std::chrono::milliseconds flushInterval,
+                           size_t maxBacklog)
+    : file(filename, std::ios::app), flushInterval(flushInterval), maxBacklog(std::max<size_t>(maxBacklog, 1)) {
+    writer = std::thread(&FileObserver::writerLoop, this);
 }
 
 FileObserver::~FileObserver() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
 }
 
-void FileObserver::onKill(const std::string& killer, const std::string& victim) {
-    std::ofstream file("log.txt", std::ios::app);
-    if (file.is_open()) {
-        auto now = std::chrono::system_clock::now();
-        auto time_t_now = std::chrono::system_clock::to_time_t(now);
+const char* FileObserver::timestamp() {
+    std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    if (now != cachedTime || cachedStamp[0] == '\0') {
         struct tm timeinfo;
-        localtime_s(&timeinfo, &time_t_now);
-        
-        char buffer[80];
-        strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &timeinfo);
+#ifdef _WIN32
+        localtime_s(&timeinfo, &now);
+#else
+        localtime_r(&now, &timeinfo);
+#endif
+        strftime(cachedStamp, sizeof(cachedStamp), "%Y-%m-%d %H:%M:%S", &timeinfo);
+        cachedTime = now;
+    }
+    return cachedStamp;
+}
+
+void FileObserver::onKill(const std::string& killer, const std::string& victim) {
+    std::unique_lock<std::mutex> lock(mutex);
+    // Ограниченный буфер: ждем, пока писатель освободит место
+    progress.wait(lock, [this] { return pendingLines < maxBacklog || stopping; });
+    append(killer, victim);
+}
+
+void FileObserver::onKills(Span<const KillEvent> kills) {
+    const NameTable& names = NameTable::global();
+    std::unique_lock<std::mutex> lock(mutex);
+    for (const KillEvent& kill : kills) {
+        progress.wait(lock, [this] { return pendingLines < maxBacklog || stopping; });
+        append(names.resolve(kill.killerName), names.resolve(kill.victimName));
+        if (kill.mutual) {
+            progress.wait(lock, [this] { return pendingLines < maxBacklog || stopping; });
+            append(names.resolve(kill.victimName), names.resolve(kill.killerName));
+        }
+    }
+}
+
+void FileObserver::append(const std::string& killer, const std::string& victim) {
+    pending += timestamp();
+    pending += " KILL: ";
+    pending += killer;
+    pending += " -> ";
+    pending += victim;
+    pending += '\n';
+    pendingLines++;
+    accepted++;
+    
+    if (pendingLines >= maxBacklog) {
+        wake.notify_one();
+    }
+}
+
+void FileObserver::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    uint64_t target = accepted;
+    flushRequested = true;
+    wake.notify_one();
+    progress.wait(lock, [&] { return written >= target; });
+}
+
+void FileObserver::writerLoop() {
+    std::string batch;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait_for(lock, flushInterval, [this] {
+            return stopping || flushRequested || pendingLines >= maxBacklog;
+        });
+        flushRequested = false;
         
-        file << buffer << " KILL: " << killer << " -> " << victim << std::endl;
+        if (pendingLines > 0) {
+            batch.swap(pending);
+            uint64_t batchEnd = accepted;
+            pendingLines = 0;
+            progress.notify_all();
+            
+            // Пишем без блокировки: производители тем временем наполняют pending
+            lock.unlock();
+            if (file.is_open()) {
+                file.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+                file.flush();
+            }
+            batch.clear();
+            lock.lock();
+            
+            written = batchEnd;
+            progress.notify_all();
+        } else if (stopping) {
+            return;
+        }
+    }
+}
+
+void EventWriter::kill(const KillEvent& event) {
+    buffer.kills.push_back(event);
+}
+
+void EventWriter::move(const MoveEvent& event) {
+    buffer.moves.push_back(event);
+}
+
+void EventWriter::spawn(const SpawnEvent& event) {
+    buffer.spawns.push_back(event);
+}
+
+namespace {
+
+std::atomic<uint64_t> nextBusId{1};
+
+// Буферы сливаются в порядке регистрации потоков; события вида, на который
+// никто не подписан, просто выбрасываются
+template <typename Event>
+void gather(std::vector<Event>& out, std::vector<Event>& from, bool wanted) {
+    if (wanted) {
+        out.insert(out.end(), from.begin(), from.end());
+    }
+    from.clear();
+}
+
+// Устойчивая сортировка сохраняет порядок записи внутри тика
+
+template <typename Event>
+void sortByTick(std::vector<Event>& events) {
+    auto byTick = [](const Event& a, const Event& b) { return a.tick < b.tick; };
+    if (!std::is_sorted(events.begin(), events.end(), byTick)) {
+        std::stable_sort(events.begin(), events.end(), byTick);
     }
 }
 
+}
+
+Observable::Observable() : id(nextBusId++) {
+}
+
 void Observable::addObserver(std::shared_ptr<Observer> observer) {
+    subscribed |= observer->events();
     observers.push_back(observer);
 }
 
 void Observable::notifyKill(const std::string& killer, const std::string& victim) {
     for (auto& observer : observers) {
-        observer->onKill(killer, victim);
+        if (observer->events() & EVENT_KILLS) {
+            observer->onKill(killer, victim);
+        }
+    }
+}
+
+EventWriter::Buffer& Observable::localBuffer() {
+    // Поток обычно пишет в одну шину: ее буфер запоминается без поиска
+    thread_local uint64_t cachedBus = 0;
+    thread_local EventWriter::Buffer* cachedBuffer = nullptr;
+    if (cachedBus == id) return *cachedBuffer;
+    
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    const std::thread::id self = std::this_thread::get_id();
+    auto it = std::find_if(buffers.begin(), buffers.end(),
+                           [&](const auto& entry) { return entry.first == self; });
+    if (it == buffers.end()) {
+        buffers.emplace_back(self, std::make_unique<EventWriter::Buffer>());
+        it = buffers.end() - 1;
+    }
+    cachedBus = id;
+    cachedBuffer = it->second.get();
+    return *cachedBuffer;
+}
+
+EventWriter Observable::writer() {
+    return EventWriter(localBuffer());
+}
+
+void Observable::record(const KillEvent& event) {
+    writer().kill(event);
+}
+
+bool Observable::wants(EventKind kind) const {
+    return (subscribed.load(std::memory_order_relaxed) & kind) != 0;
+}
+
+void Observable::flush() {
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        for (auto& entry : buffers) {
+            EventWriter::Buffer& buffer = *entry.second;
+            std::lock_guard<std::mutex> bufferLock(buffer.mutex);
+            gather(kills, buffer.kills, wants(EVENT_KILLS));
+            gather(moves, buffer.moves, wants(EVENT_MOVES));
+            gather(spawns, buffer.spawns, wants(EVENT_SPAWNS));
+        }
+    }
+    sortByTick(kills);
+    sortByTick(moves);
+    sortByTick(spawns);
+    
+    for (auto& observer : observers) {
+        unsigned wanted = observer->events();
+        if ((wanted & EVENT_SPAWNS) && !spawns.empty()) {
+            observer->onSpawns(Span<const SpawnEvent>(spawns.data(), spawns.size()));
+        }
+        if ((wanted & EVENT_MOVES) && !moves.empty()) {
+            observer->onMoves(Span<const MoveEvent>(moves.data(), moves.size()));
+        }
+        if ((wanted & EVENT_KILLS) && !kills.empty()) {
+            observer->onKills(Span<const KillEvent>(kills.data(), kills.size()));
+        }
     }
+    kills.clear();
+    moves.clear();
+    spawns.clear();
 }
\ No newline at end of file
@@ -1,35 +1,209 @@
 #ifndef OBSERVER_H
 #define OBSERVER_H
 
+#include "name_table.h"
+#include "npc.h"
 #include <string>
 #include <memory>
 #include <vector>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+// События мира - POD-записи без строк: имена передаются идентификаторами
+// NameTable::global(), NPC - хэндлом мира (движок) или индексом (редактор).
+struct KillEvent {
+    uint32_t tick;
+    uint32_t killer;
+    uint32_t victim;
+    NameId killerName;
+    NameId victimName;
+    bool mutual;  // оба убили друг друга
+};
+
+struct MoveEvent {
+    uint32_t tick;
+    uint32_t npc;
+    int32_t x;
+    int32_t y;
+};
+
+struct SpawnEvent {
+    uint32_t tick;
+    uint32_t npc;
+    NameId name;
+    int32_t x;
+    int32_t y;
+    NPCType type;
+};
+
+// Виды событий для Observer::events()
+enum EventKind : unsigned {
+    EVENT_KILLS = 1u << 0,
+    EVENT_MOVES = 1u << 1,
+    EVENT_SPAWNS = 1u << 2
+};
+
+// Непрерывный диапазон только для чтения (std::span появится в C++20)
+template <typename T>
+class Span {
+public:
+    Span() = default;
+    Span(T* data, size_t count) : ptr(data), count(count) {}
+    
+    T* begin() const { return ptr; }
+    T* end() const { return ptr + count; }
+    T& operator[](size_t i) const { return ptr[i]; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    
+private:
+    T* ptr = nullptr;
+    size_t count = 0;
+};
 
 class Observer {
 public:
     virtual ~Observer() = default;
-    virtual void onKill(const std::string& killer, const std::string& victim) = 0;
+    // Одно убийство с именами
+    virtual void onKill(const std::string& killer, const std::string& victim) { (void)killer; (void)victim; }
+    
+    // Пачки событий по возрастанию тика. По умолчанию onKills вызывает onKill
+    // на каждое убийство, на взаимное - дважды
+    virtual void onKills(Span<const KillEvent> kills);
+    virtual void onMoves(Span<const MoveEvent> moves) { (void)moves; }
+    virtual void onSpawns(Span<const SpawnEvent> spawns) { (void)spawns; }
+    
+    // Нужные наблюдателю виды событий (EventKind); остальные ему не доставляются,
+    // а перемещения без подписчиков не записываются вовсе
+    virtual unsigned events() const { return EVENT_KILLS; }
 };
 
 class ConsoleObserver : public Observer {
 public:
     void onKill(const std::string& killer, const std::string& victim) override;
+    // Вся пачка - одна запись в cout
+    void onKills(Span<const KillEvent> kills) override;
+    
+private:
+    std::string buffer;
 };
 
+// Пишет убийства в файл фоновым потоком: onKill только дописывает строку
+// в буфер, а поток раз в flushInterval (или при заполнении) пишет весь буфер
+// одним вызовом в постоянно открытый файл. Если в буфере maxBacklog строк,
+// onKill ждет записи. Деструктор дописывает все, что накоплено.
 class FileObserver : public Observer {
 public:
-    FileObserver();
+    explicit FileObserver(const std::string& filename = "log.txt",
+                          std::chrono::milliseconds flushInterval = std::chrono::milliseconds(100),
+                          size_t maxBacklog = 65536);
     ~FileObserver();
     void onKill(const std::string& killer, const std::string& victim) override;
+    // Вся пачка под одной блокировкой
+    void onKills(Span<const KillEvent> kills) override;
+    
+    // Ждет, пока все уже принятые строки не будут записаны
+    void flush();
+
+private:
+    void writerLoop();
+    const char* timestamp();
+    void append(const std::string& killer, const std::string& victim);
+    
+    std::ofstream file;
+    std::chrono::milliseconds flushInterval;
+    size_t maxBacklog;
+    
+    std::mutex mutex;
+    std::condition_variable wake;       // писателю: есть работа или стоп
+    std::condition_variable progress;   // производителям: буфер записан
+    std::string pending;
+    size_t pendingLines = 0;
+    uint64_t accepted = 0;
+    uint64_t written = 0;
+    bool stopping = false;
+    bool flushRequested = false;
+    
+    // Метка времени меняется раз в секунду, форматируем ее один раз
+    std::time_t cachedTime = 0;
+    char cachedStamp[32] = {0};
+    
+    std::thread writer;
+};
+
+class Observable;
+
+// Запись событий в буфер текущего потока; держит его блокировку, за которую
+// соперничает только flush, поэтому пишущие потоки друг друга не ждут
+class EventWriter {
+public:
+    EventWriter(const EventWriter&) = delete;
+    EventWriter& operator=(const EventWriter&) = delete;
+    
+    void kill(const KillEvent& event);
+    void move(const MoveEvent& event);
+    void spawn(const SpawnEvent& event);
+    
+private:
+    friend class Observable;
+    struct Buffer {
+        std::mutex mutex;
+        std::vector<KillEvent> kills;
+        std::vector<MoveEvent> moves;
+        std::vector<SpawnEvent> spawns;
+    };
+    
+    explicit EventWriter(Buffer& buffer) : lock(buffer.mutex), buffer(buffer) {}
+    
+    std::lock_guard<std::mutex> lock;
+    Buffer& buffer;
 };
 
+// Шина событий. Постоянна: создается один раз, наблюдатели подключаются
+// заранее. События копятся POD-записями в буферах потоков, которые их
+// пишут, и доставляются пачками в flush (обычно раз в конце тика); после
+// прогрева ни запись, ни доставка не выделяют память.
 class Observable {
 public:
+    Observable();
+    
+    // Не во время flush
     void addObserver(std::shared_ptr<Observer> observer);
+    // Сразу всем наблюдателям убийств, минуя буферы (прежний API)
     void notifyKill(const std::string& killer, const std::string& victim);
-
+    
+    // Буфер вызывающего потока; первая запись потока в шину регистрирует буфер
+    EventWriter writer();
+    void record(const KillEvent& event);
+    // Есть ли наблюдатели, которым нужны события вида kind
+    bool wants(EventKind kind) const;
+    
+    // Доставляет накопленное всех потоков: onSpawns, onMoves, onKills, каждый
+    // вид по возрастанию тика. Вызывает один поток за раз; запись из других
+    // потоков в это время допустима и попадет в следующий flush
+    void flush();
+    
 private:
+    EventWriter::Buffer& localBuffer();
+    
+    const uint64_t id;  // отличает шины в кэше буфера потока
     std::vector<std::shared_ptr<Observer>> observers;
+    std::atomic<unsigned> subscribed{0};
+    
+    std::mutex buffersMutex;
+    std::vector<std::pair<std::thread::id, std::unique_ptr<EventWriter::Buffer>>> buffers;
+    
+    // Собранное в flush; емкость сохраняется между вызовами
+    std::vector<KillEvent> kills;
+    std::vector<MoveEvent> moves;
+    std::vector<SpawnEvent> spawns;
 };
 
-#endif  
\ No newline at end of file
+#endif
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef RNG_STREAM_H
+#define RNG_STREAM_H
+
+#include <cstdint>
+#include <limits>
+
+// Перемешивание SplitMix64
+inline uint64_t splitMix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Независимый seed для подсистемы или NPC, полученный из seed прогона
+inline uint64_t deriveSeed(uint64_t runSeed, uint64_t streamId) {
+    return splitMix64(runSeed ^ splitMix64(streamId));
+}
+
+// Дешевый счетчиковый генератор: значение номер k зависит только от
+// (seed, streamId, k), поэтому у каждого NPC или потока может быть свой
+// поток без общего состояния, а прогон воспроизводится при любом числе потоков.
+// Подходит как UniformRandomBitGenerator для <random>.
+class RngStream {
+public:
+    using result_type = uint64_t;
+
+    RngStream() : key(0), counter(0) {}
+    RngStream(uint64_t runSeed, uint64_t streamId)
+        : key(deriveSeed(runSeed, streamId)), counter(0) {}
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    result_type operator()() {
+        return splitMix64(key + 0x9e3779b97f4a7c15ULL * counter++);
+    }
+
+    // Равномерное целое в [lo, hi] без зависимости от реализации <random>
+    int uniformInt(int lo, int hi) {
+        uint64_t span = static_cast<uint64_t>(static_cast<int64_t>(hi) - lo) + 1;
+        uint64_t r = (*this)() >> 32;
+        return static_cast<int>(lo + static_cast<int64_t>((r * span) >> 32));
+    }
+
+    uint64_t position() const { return counter; }
+    void seek(uint64_t position) { counter = position; }
+
+private:
+    uint64_t key;
+    uint64_t counter;
+};
+
+#endif
@@ -0,0 +1,329 @@
+#include "simd_kernels.h"
+#include "alive_bitset.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define RPG_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define RPG_TARGET_AVX2
+#define RPG_TARGET_SSE42
+#else
+#define RPG_TARGET_AVX2 __attribute__((target("avx2")))
+#define RPG_TARGET_SSE42 __attribute__((target("sse4.2")))
+#endif
+#endif
+
+namespace {
+
+// Хэш lowbias32 (Chris Wellons): хорошо перемешивает соседние счетчики
+// и использует только 32-битные умножения, которые есть в SSE4.1/AVX2
+constexpr uint32_t MIX_MUL1 = 0x7feb352dU;
+constexpr uint32_t MIX_MUL2 = 0x846ca68bU;
+
+inline uint32_t mix32(uint32_t x) {
+    x ^= x >> 16;
+    x *= MIX_MUL1;
+    x ^= x >> 15;
+    x *= MIX_MUL2;
+    x ^= x >> 16;
+    return x;
+}
+
+// Старшие 16 бит хэша масштабируются в [0, span); span < 65536
+inline int32_t stepFromHash(uint32_t h, uint32_t span, int32_t maxStep) {
+    return static_cast<int32_t>(((h >> 16) * span) >> 16) - maxStep;
+}
+
+void inRangeMaskScalar(const int32_t* xs, const int32_t* ys, size_t from, size_t n,
+                       int32_t cx, int32_t cy, int64_t range2, uint8_t* out) {
+    for (size_t i = from; i < n; ++i) {
+        int64_t dx = static_cast<int64_t>(xs[i]) - cx;
+        int64_t dy = static_cast<int64_t>(ys[i]) - cy;
+        out[i] = dx*dx + dy*dy <= range2 ? 1 : 0;
+    }
+}
+
+void applyMovesScalar(int32_t* xs, int32_t* ys, const int32_t* dx, const int32_t* dy,
+                      const uint64_t* aliveBits, size_t from, size_t n, int32_t maxX, int32_t maxY) {
+    size_t i = from;
+    while (i < n) {
+        // Живые NPC слова, начиная с i; мертвые пропускаются по биту за раз
+        uint64_t word = aliveBits[i / 64] >> (i % 64);
+        const size_t wordEnd = std::min(n, (i / 64 + 1) * 64);
+        while (word) {
+            size_t j = i + static_cast<size_t>(countTrailingZeros(word));
+            if (j >= wordEnd) break;
+            xs[j] = std::max(0, std::min(maxX - 1, xs[j] + dx[j]));
+            ys[j] = std::max(0, std::min(maxY - 1, ys[j] + dy[j]));
+            word &= word - 1;
+        }
+        i = wordEnd;
+    }
+}
+
+void randomStepsScalar(uint32_t key, uint32_t counter, int32_t* out, size_t from, size_t n,
+                       int32_t maxStep) {
+    const uint32_t span = static_cast<uint32_t>(2 * maxStep + 1);
+    for (size_t i = from; i < n; ++i) {
+        uint32_t h = mix32((counter + static_cast<uint32_t>(i)) ^ key);
+        out[i] = stepFromHash(h, span, maxStep);
+    }
+}
+
+#ifdef RPG_SIMD_X86
+
+// Маски "вне радиуса" для четных и нечетных 32-битных дорожек -> байты 0/1
+inline void storeMaskBytes(int evenOut, int oddOut, int lanes, uint8_t* out) {
+    for (int k = 0; k < lanes / 2; ++k) {
+        out[2 * k] = ((evenOut >> k) & 1) ? 0 : 1;
+        out[2 * k + 1] = ((oddOut >> k) & 1) ? 0 : 1;
+    }
+}
+
+RPG_TARGET_AVX2
+size_t inRangeMaskAVX2(const int32_t* xs, const int32_t* ys, size_t n,
+                       int32_t cx, int32_t cy, int64_t range2, uint8_t* out) {
+    const __m256i vcx = _mm256_set1_epi32(cx);
+    const __m256i vcy = _mm256_set1_epi32(cy);
+    const __m256i vr2 = _mm256_set1_epi64x(range2);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i dx = _mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(xs + i)), vcx);
+        __m256i dy = _mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ys + i)), vcy);
+        // 64-битные квадраты: _mm256_mul_epi32 берет четные дорожки
+        __m256i even = _mm256_add_epi64(_mm256_mul_epi32(dx, dx), _mm256_mul_epi32(dy, dy));
+        __m256i ox = _mm256_srli_epi64(dx, 32);
+        __m256i oy = _mm256_srli_epi64(dy, 32);
+        __m256i odd = _mm256_add_epi64(_mm256_mul_epi32(ox, ox), _mm256_mul_epi32(oy, oy));
+        int evenOut = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(even, vr2)));
+        int oddOut = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(odd, vr2)));
+        storeMaskBytes(evenOut, oddOut, 8, out + i);
+    }
+    return i;
+}
+
+RPG_TARGET_SSE42
+size_t inRangeMaskSSE42(const int32_t* xs, const int32_t* ys, size_t n,
+                        int32_t cx, int32_t cy, int64_t range2, uint8_t* out) {
+    const __m128i vcx = _mm_set1_epi32(cx);
+    const __m128i vcy = _mm_set1_epi32(cy);
+    const __m128i vr2 = _mm_set1_epi64x(range2);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i dx = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(xs + i)), vcx);
+        __m128i dy = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ys + i)), vcy);
+        __m128i even = _mm_add_epi64(_mm_mul_epi32(dx, dx), _mm_mul_epi32(dy, dy));
+        __m128i ox = _mm_srli_epi64(dx, 32);
+        __m128i oy = _mm_srli_epi64(dy, 32);
+        __m128i odd = _mm_add_epi64(_mm_mul_epi32(ox, ox), _mm_mul_epi32(oy, oy));
+        int evenOut = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(even, vr2)));
+        int oddOut = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(odd, vr2)));
+        storeMaskBytes(evenOut, oddOut, 4, out + i);
+    }
+    return i;
+}
+
+RPG_TARGET_AVX2
+size_t applyMovesAVX2(int32_t* xs, int32_t* ys, const int32_t* dx, const int32_t* dy,
+                      const uint64_t* aliveBits, size_t n, int32_t maxX, int32_t maxY) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i hiX = _mm256_set1_epi32(maxX - 1);
+    const __m256i hiY = _mm256_set1_epi32(maxY - 1);
+    const __m256i laneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t word = aliveBits[i / 64];
+        if (word == 0 && i % 64 == 0 && i + 64 <= n) {
+            i += 56;  // все 64 NPC слова мертвы
+            continue;
+        }
+        const int32_t bits = static_cast<int32_t>((word >> (i % 64)) & 0xFF);
+        if (bits == 0) continue;
+        __m256i* px = reinterpret_cast<__m256i*>(xs + i);
+        __m256i* py = reinterpret_cast<__m256i*>(ys + i);
+        __m256i x = _mm256_loadu_si256(px);
+        __m256i y = _mm256_loadu_si256(py);
+        __m256i nx = _mm256_add_epi32(x, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dx + i)));
+        __m256i ny = _mm256_add_epi32(y, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dy + i)));
+        nx = _mm256_min_epi32(_mm256_max_epi32(nx, zero), hiX);
+        ny = _mm256_min_epi32(_mm256_max_epi32(ny, zero), hiY);
+        // Мертвые NPC остаются на месте
+        __m256i dead = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(bits), laneBits), zero);
+        _mm256_storeu_si256(px, _mm256_blendv_epi8(nx, x, dead));
+        _mm256_storeu_si256(py, _mm256_blendv_epi8(ny, y, dead));
+    }
+    return i;
+}
+
+RPG_TARGET_SSE42
+size_t applyMovesSSE42(int32_t* xs, int32_t* ys, const int32_t* dx, const int32_t* dy,
+                       const uint64_t* aliveBits, size_t n, int32_t maxX, int32_t maxY) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i hiX = _mm_set1_epi32(maxX - 1);
+    const __m128i hiY = _mm_set1_epi32(maxY - 1);
+    const __m128i laneBits = _mm_setr_epi32(1, 2, 4, 8);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint64_t word = aliveBits[i / 64];
+        if (word == 0 && i % 64 == 0 && i + 64 <= n) {
+            i += 60;  // все 64 NPC слова мертвы
+            continue;
+        }
+        const int32_t bits = static_cast<int32_t>((word >> (i % 64)) & 0xF);
+        if (bits == 0) continue;
+        __m128i* px = reinterpret_cast<__m128i*>(xs + i);
+        __m128i* py = reinterpret_cast<__m128i*>(ys + i);
+        __m128i x = _mm_loadu_si128(px);
+        __m128i y = _mm_loadu_si128(py);
+        __m128i nx = _mm_add_epi32(x, _mm_loadu_si128(reinterpret_cast<const __m128i*>(dx + i)));
+        __m128i ny = _mm_add_epi32(y, _mm_loadu_si128(reinterpret_cast<const __m128i*>(dy + i)));
+        nx = _mm_min_epi32(_mm_max_epi32(nx, zero), hiX);
+        ny = _mm_min_epi32(_mm_max_epi32(ny, zero), hiY);
+        __m128i dead = _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(bits), laneBits), zero);
+        _mm_storeu_si128(px, _mm_blendv_epi8(nx, x, dead));
+        _mm_storeu_si128(py, _mm_blendv_epi8(ny, y, dead));
+    }
+    return i;
+}
+
+RPG_TARGET_AVX2
+size_t randomStepsAVX2(uint32_t key, uint32_t counter, int32_t* out, size_t n, int32_t maxStep) {
+    const __m256i vkey = _mm256_set1_epi32(static_cast<int32_t>(key));
+    const __m256i mul1 = _mm256_set1_epi32(static_cast<int32_t>(MIX_MUL1));
+    const __m256i mul2 = _mm256_set1_epi32(static_cast<int32_t>(MIX_MUL2));
+    const __m256i span = _mm256_set1_epi32(2 * maxStep + 1);
+    const __m256i offset = _mm256_set1_epi32(maxStep);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int32_t>(counter + static_cast<uint32_t>(i))), lanes);
+        x = _mm256_xor_si256(x, vkey);
+        x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+        x = _mm256_mullo_epi32(x, mul1);
+        x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 15));
+        x = _mm256_mullo_epi32(x, mul2);
+        x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+        __m256i s = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(x, 16), span), 16);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_sub_epi32(s, offset));
+    }
+    return i;
+}
+
+RPG_TARGET_SSE42
+size_t randomStepsSSE42(uint32_t key, uint32_t counter, int32_t* out, size_t n, int32_t maxStep) {
+    const __m128i vkey = _mm_set1_epi32(static_cast<int32_t>(key));
+    const __m128i mul1 = _mm_set1_epi32(static_cast<int32_t>(MIX_MUL1));
+    const __m128i mul2 = _mm_set1_epi32(static_cast<int32_t>(MIX_MUL2));
+    const __m128i span = _mm_set1_epi32(2 * maxStep + 1);
+    const __m128i offset = _mm_set1_epi32(maxStep);
+    const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_add_epi32(_mm_set1_epi32(static_cast<int32_t>(counter + static_cast<uint32_t>(i))), lanes);
+        x = _mm_xor_si128(x, vkey);
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+        x = _mm_mullo_epi32(x, mul1);
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 15));
+        x = _mm_mullo_epi32(x, mul2);
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+        __m128i s = _mm_srli_epi32(_mm_mullo_epi32(_mm_srli_epi32(x, 16), span), 16);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_sub_epi32(s, offset));
+    }
+    return i;
+}
+
+#endif
+
+std::atomic<int> g_level{static_cast<int>(detectSimdLevel())};
+
+}
+
+SimdLevel detectSimdLevel() {
+#ifdef RPG_SIMD_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    bool sse42 = (info[2] & (1 << 20)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    __cpuidex(info, 7, 0);
+    bool avx2 = (info[1] & (1 << 5)) != 0;
+    if (avx2 && avx && osxsave && (_xgetbv(0) & 6) == 6) return SimdLevel::AVX2;
+    if (sse42) return SimdLevel::SSE42;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse4.2")) return SimdLevel::SSE42;
+#endif
+#endif
+    return SimdLevel::Scalar;
+}
+
+SimdLevel activeSimdLevel() {
+    return static_cast<SimdLevel>(g_level.load(std::memory_order_relaxed));
+}
+
+SimdLevel setSimdLevel(SimdLevel level) {
+    SimdLevel chosen = std::min(level, detectSimdLevel());
+    g_level.store(static_cast<int>(chosen), std::memory_order_relaxed);
+    return chosen;
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX2: return "AVX2";
+        case SimdLevel::SSE42: return "SSE4.2";
+        default: return "scalar";
+    }
+}
+
+void inRangeMask(const int32_t* xs, const int32_t* ys, size_t n,
+                 int32_t cx, int32_t cy, int64_t range2, uint8_t* out) {
+    size_t done = 0;
+#ifdef RPG_SIMD_X86
+    switch (activeSimdLevel()) {
+        case SimdLevel::AVX2: done = inRangeMaskAVX2(xs, ys, n, cx, cy, range2, out); break;
+        case SimdLevel::SSE42: done = inRangeMaskSSE42(xs, ys, n, cx, cy, range2, out); break;
+        default: break;
+    }
+#endif
+    inRangeMaskScalar(xs, ys, done, n, cx, cy, range2, out);
+}
+
+void applyMoves(int32_t* xs, int32_t* ys, const int32_t* dx, const int32_t* dy,
+                const uint64_t* aliveBits, size_t n, int32_t maxX, int32_t maxY) {
+    size_t done = 0;
+#ifdef RPG_SIMD_X86
+    switch (activeSimdLevel()) {
+        case SimdLevel::AVX2: done = applyMovesAVX2(xs, ys, dx, dy, aliveBits, n, maxX, maxY); break;
+        case SimdLevel::SSE42: done = applyMovesSSE42(xs, ys, dx, dy, aliveBits, n, maxX, maxY); break;
+        default: break;
+    }
+#endif
+    applyMovesScalar(xs, ys, dx, dy, aliveBits, done, n, maxX, maxY);
+}
+
+uint32_t makeStreamKey(uint64_t seed) {
+    return mix32(static_cast<uint32_t>(seed) ^ mix32(static_cast<uint32_t>(seed >> 32) + 0x9e3779b9U));
+}
+
+uint32_t streamHash(uint32_t key, uint32_t counter) {
+    return mix32(counter ^ key);
+}
+
+void randomSteps(uint32_t key, uint32_t counter, int32_t* out, size_t n, int32_t maxStep) {
+    maxStep = std::max(0, std::min(maxStep, 32767));
+    size_t done = 0;
+#ifdef RPG_SIMD_X86
+    switch (activeSimdLevel()) {
+        case SimdLevel::AVX2: done = randomStepsAVX2(key, counter, out, n, maxStep); break;
+        case SimdLevel::SSE42: done = randomStepsSSE42(key, counter, out, n, maxStep); break;
+        default: break;
+    }
+#endif
+    randomStepsScalar(key, counter, out, done, n, maxStep);
+}
@@ -0,0 +1,41 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Пакетные ядра над непрерывными массивами координат.
+// Реализация выбирается при запуске: AVX2, затем SSE4.2, иначе скалярная.
+// Все уровни дают побитно одинаковый результат.
+enum class SimdLevel {
+    Scalar,
+    SSE42,
+    AVX2
+};
+
+SimdLevel detectSimdLevel();
+SimdLevel activeSimdLevel();
+// Принудительный выбор уровня (для тестов и бенчмарков); ограничивается
+// тем, что поддерживает процессор. Возвращает фактически выбранный уровень.
+SimdLevel setSimdLevel(SimdLevel level);
+const char* simdLevelName(SimdLevel level);
+
+// out[i] = 1, если (xs[i]-cx)^2 + (ys[i]-cy)^2 <= range2, иначе 0.
+// Разности координат должны помещаться в int32.
+void inRangeMask(const int32_t* xs, const int32_t* ys, size_t n,
+                 int32_t cx, int32_t cy, int64_t range2, uint8_t* out);
+
+// Для живых NPC: x += dx, y += dy с ограничением в [0, maxX-1] x [0, maxY-1].
+// aliveBits - битовая маска: NPC i жив, если установлен бит i % 64 слова i / 64.
+// Полностью мертвые слова пропускаются целиком.
+void applyMoves(int32_t* xs, int32_t* ys, const int32_t* dx, const int32_t* dy,
+                const uint64_t* aliveBits, size_t n, int32_t maxX, int32_t maxY);
+
+// Счетчиковый генератор: out[i] - шаг в [-maxStep, maxStep], зависящий
+// только от ключа и номера counter + i, поэтому поток можно резать на части.
+uint32_t makeStreamKey(uint64_t seed);
+// Одно значение потока: тот же хэш, из которого randomSteps берет шаг номер counter
+uint32_t streamHash(uint32_t key, uint32_t counter);
+void randomSteps(uint32_t key, uint32_t counter, int32_t* out, size_t n, int32_t maxStep);
+
+#endif
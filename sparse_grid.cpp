@@ -0,0 +1,123 @@
+#include "sparse_grid.h"
+#include "alive_bitset.h"
+
+void SparseGrid::rebuild(const uint32_t* ids, const int32_t* xs, const int32_t* ys,
+                         const uint64_t* aliveBits, size_t count) {
+    // Таблица хотя бы вдвое больше числа живых: чанков не больше, чем NPC
+    size_t alive = 0;
+    const size_t words = (count + 63) / 64;
+    for (size_t word = 0; word < words; ++word) {
+        alive += static_cast<size_t>(popCount(aliveBits[word]));
+    }
+    size_t capacity = 16;
+    while (capacity < alive * 2) capacity *= 2;
+    tableKeys.assign(capacity, EMPTY_KEY);
+    tableValues.resize(capacity);
+    tableMask = capacity - 1;
+
+    // Живые слоты и номер чанка каждого; чанки нумеруются по первому появлению
+    order.clear();
+    slotChunk.clear();
+    chunkKeys.clear();
+    order.reserve(alive);
+    slotChunk.reserve(alive);
+    for (size_t word = 0; word < words; ++word) {
+        for (uint64_t bits = aliveBits[word]; bits != 0; bits &= bits - 1) {
+            size_t slot = word * 64 + static_cast<size_t>(countTrailingZeros(bits));
+            uint64_t key = chunkKey(xs[slot] >> CHUNK_SHIFT, ys[slot] >> CHUNK_SHIFT);
+            size_t pos = hashKey(key) & tableMask;
+            while (tableKeys[pos] != key && tableKeys[pos] != EMPTY_KEY) {
+                pos = (pos + 1) & tableMask;
+            }
+            if (tableKeys[pos] == EMPTY_KEY) {
+                tableKeys[pos] = key;
+                tableValues[pos] = static_cast<uint32_t>(chunkKeys.size());
+                chunkKeys.push_back(key);
+            }
+            order.push_back(static_cast<uint32_t>(slot));
+            slotChunk.push_back(tableValues[pos]);
+        }
+    }
+
+    minChunkX = minChunkY = INT32_MAX;
+    maxChunkX = maxChunkY = INT32_MIN;
+    for (uint64_t key : chunkKeys) {
+        minChunkX = std::min(minChunkX, chunkXOf(key));
+        maxChunkX = std::max(maxChunkX, chunkXOf(key));
+        minChunkY = std::min(minChunkY, chunkYOf(key));
+        maxChunkY = std::max(maxChunkY, chunkYOf(key));
+    }
+
+    // Сортировка подсчетом по чанкам
+    chunkStart.assign(chunkKeys.size() + 1, 0);
+    for (uint32_t chunk : slotChunk) {
+        chunkStart[chunk + 1]++;
+    }
+    for (size_t c = 1; c < chunkStart.size(); ++c) {
+        chunkStart[c] += chunkStart[c - 1];
+    }
+    fill.assign(chunkStart.begin(), chunkStart.end() - 1);
+    entries.resize(order.size());
+    uint32_t maxId = 0;
+    for (size_t k = 0; k < order.size(); ++k) {
+        uint32_t slot = order[k];
+        uint32_t cell = (static_cast<uint32_t>(ys[slot] & (CHUNK_SIZE - 1)) << CHUNK_SHIFT) |
+                        static_cast<uint32_t>(xs[slot] & (CHUNK_SIZE - 1));
+        entries[fill[slotChunk[k]]++] = {cell, ids[slot]};
+        maxId = std::max(maxId, ids[slot]);
+    }
+
+    // Внутри чанка - по клеткам, в клетке - по id
+    for (size_t c = 0; c + 1 < chunkStart.size(); ++c) {
+        if (chunkStart[c + 1] - chunkStart[c] < 2) continue;
+        std::sort(entries.begin() + chunkStart[c], entries.begin() + chunkStart[c + 1],
+                  [](const Entry& a, const Entry& b) {
+                      return a.cell != b.cell ? a.cell < b.cell : a.id < b.id;
+                  });
+    }
+
+    entryOf.assign(order.empty() ? 0 : static_cast<size_t>(maxId) + 1, NONE);
+    for (size_t e = 0; e < entries.size(); ++e) {
+        entryOf[entries[e].id] = static_cast<uint32_t>(e);
+    }
+    live = entries.size();
+}
+
+void SparseGrid::remove(uint32_t id) {
+    if (!contains(id)) return;
+    entries[entryOf[id]].id = NONE;
+    entryOf[id] = NONE;
+    live--;
+}
+
+bool SparseGrid::contains(uint32_t id) const {
+    return id < entryOf.size() && entryOf[id] != NONE;
+}
+
+void SparseGrid::clear() {
+    chunkKeys.clear();
+    chunkStart.clear();
+    tableKeys.clear();
+    tableValues.clear();
+    tableMask = 0;
+    minChunkX = minChunkY = 0;
+    maxChunkX = maxChunkY = -1;
+    entries.clear();
+    entryOf.clear();
+    live = 0;
+}
+
+size_t SparseGrid::size() const {
+    return live;
+}
+
+size_t SparseGrid::chunkCount() const {
+    return chunkKeys.size();
+}
+
+size_t SparseGrid::memoryUsage() const {
+    return chunkKeys.capacity() * sizeof(uint64_t) + chunkStart.capacity() * sizeof(uint32_t) +
+           tableKeys.capacity() * sizeof(uint64_t) + tableValues.capacity() * sizeof(uint32_t) +
+           entries.capacity() * sizeof(Entry) + entryOf.capacity() * sizeof(uint32_t) +
+           (order.capacity() + slotChunk.capacity() + fill.capacity()) * sizeof(uint32_t);
+}
@@ -0,0 +1,187 @@
+#ifndef SPARSE_GRID_H
+#define SPARSE_GRID_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Разреженная сетка занятости для больших почти пустых карт. Карта делится
+// на чанки CHUNK_SIZE x CHUNK_SIZE; хранятся только чанки, где есть NPC, -
+// память пропорциональна числу NPC, а не площади карты. Координаты не
+// ограничены: отрицательные попадают в чанки с отрицательными номерами.
+//
+// Сетка перестраивается целиком раз за тик (rebuild): NPC раскладываются по
+// чанкам, внутри чанка сортируются по клеткам, поэтому клетки строки квадрата
+// поиска находятся двоичным поиском, а пустые чанки не встречаются ни при
+// обходе, ни при поиске соседей. Чанк находится по открытой хэш-таблице
+// без выделений памяти на каждый чанк.
+class SparseGrid {
+public:
+    static constexpr int CHUNK_SHIFT = 6;
+    static constexpr int CHUNK_SIZE = 1 << CHUNK_SHIFT;
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    // Строит сетку по живым слотам: ids[slot] - идентификатор NPC в сетке,
+    // координаты xs/ys, живые слоты отмечены битами aliveBits.
+    // Порядок NPC одной клетки - порядок слотов.
+    void rebuild(const uint32_t* ids, const int32_t* xs, const int32_t* ys,
+                 const uint64_t* aliveBits, size_t count);
+    // Убирает NPC до следующей перестройки
+    void remove(uint32_t id);
+    bool contains(uint32_t id) const;
+    void clear();
+
+    // NPC в сетке и непустые чанки
+    size_t size() const;
+    size_t chunkCount() const;
+    size_t memoryUsage() const;
+
+    // fn(chunkX, chunkY) для непустых чанков в порядке первого появления
+    // при перестройке (по слотам): порядок воспроизводим от прогона к прогону
+    template <typename Fn>
+    void forEachChunk(Fn fn) const {
+        for (uint64_t key : chunkKeys) {
+            fn(chunkXOf(key), chunkYOf(key));
+        }
+    }
+
+    // fn(id, x, y) для NPC чанка по клеткам (строка за строкой)
+    template <typename Fn>
+    void forEachInChunk(int chunkX, int chunkY, Fn fn) const {
+        const Entry* first;
+        const Entry* last;
+        if (!findChunk(chunkX, chunkY, first, last)) return;
+        const int baseX = chunkX * CHUNK_SIZE;
+        const int baseY = chunkY * CHUNK_SIZE;
+        for (const Entry* e = first; e != last; ++e) {
+            if (e->id == NONE) continue;
+            fn(e->id, baseX + static_cast<int>(e->cell & (CHUNK_SIZE - 1)),
+               baseY + static_cast<int>(e->cell >> CHUNK_SHIFT));
+        }
+    }
+
+    // Обходит всех NPC в квадрате со стороной 2*radius+1 вокруг (x, y).
+    // Квадрат обрезается по границам занятых чанков; если и после этого в нем
+    // больше чанков, чем непустых, обходится список непустых чанков. Порядок
+    // NPC зависит только от содержимого сетки и квадрата.
+    template <typename Fn>
+    void forEachInSquare(int x, int y, int radius, Fn fn) const {
+        if (chunkKeys.empty()) return;
+        const int64_t minX = static_cast<int64_t>(x) - radius;
+        const int64_t maxX = static_cast<int64_t>(x) + radius;
+        const int64_t minY = static_cast<int64_t>(y) - radius;
+        const int64_t maxY = static_cast<int64_t>(y) + radius;
+        const int64_t cx0 = std::max<int64_t>(minX >> CHUNK_SHIFT, minChunkX);
+        const int64_t cx1 = std::min<int64_t>(maxX >> CHUNK_SHIFT, maxChunkX);
+        const int64_t cy0 = std::max<int64_t>(minY >> CHUNK_SHIFT, minChunkY);
+        const int64_t cy1 = std::min<int64_t>(maxY >> CHUNK_SHIFT, maxChunkY);
+        if (cx0 > cx1 || cy0 > cy1) return;
+
+        if (static_cast<uint64_t>(cx1 - cx0 + 1) * static_cast<uint64_t>(cy1 - cy0 + 1) > chunkKeys.size()) {
+            for (size_t chunk = 0; chunk < chunkKeys.size(); ++chunk) {
+                const int cx = chunkXOf(chunkKeys[chunk]);
+                const int cy = chunkYOf(chunkKeys[chunk]);
+                if (cx < cx0 || cx > cx1 || cy < cy0 || cy > cy1) continue;
+                scanChunk(cx, cy, entries.data() + chunkStart[chunk], entries.data() + chunkStart[chunk + 1],
+                          minX, maxX, minY, maxY, fn);
+            }
+            return;
+        }
+        for (int64_t cy = cy0; cy <= cy1; ++cy) {
+            for (int64_t cx = cx0; cx <= cx1; ++cx) {
+                const Entry* first;
+                const Entry* last;
+                if (!findChunk(static_cast<int>(cx), static_cast<int>(cy), first, last)) continue;
+                scanChunk(cx, cy, first, last, minX, maxX, minY, maxY, fn);
+            }
+        }
+    }
+
+private:
+    struct Entry {
+        uint32_t cell;  // локальная клетка в чанке: ly * CHUNK_SIZE + lx
+        uint32_t id;    // NONE - удален до перестройки
+    };
+
+    static constexpr uint64_t EMPTY_KEY = UINT64_MAX;  // недостижим: номер чанка < 2^26
+
+    static uint64_t chunkKey(int chunkX, int chunkY) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(chunkY) ^ 0x80000000u) << 32) |
+               (static_cast<uint32_t>(chunkX) ^ 0x80000000u);
+    }
+    static int chunkXOf(uint64_t key) {
+        return static_cast<int32_t>(static_cast<uint32_t>(key) ^ 0x80000000u);
+    }
+    static int chunkYOf(uint64_t key) {
+        return static_cast<int32_t>(static_cast<uint32_t>(key >> 32) ^ 0x80000000u);
+    }
+
+    static size_t hashKey(uint64_t key) {
+        key ^= key >> 29;
+        key *= 0xbf58476d1ce4e5b9ull;
+        return static_cast<size_t>(key ^ (key >> 32));
+    }
+
+    // Номер чанка по ключу или NONE
+    uint32_t lookup(uint64_t key) const {
+        if (tableKeys.empty()) return NONE;
+        for (size_t pos = hashKey(key) & tableMask;; pos = (pos + 1) & tableMask) {
+            if (tableKeys[pos] == key) return tableValues[pos];
+            if (tableKeys[pos] == EMPTY_KEY) return NONE;
+        }
+    }
+
+    // NPC чанка (cx, cy) в пересечении с квадратом [minX, maxX] x [minY, maxY]
+    template <typename Fn>
+    static void scanChunk(int64_t cx, int64_t cy, const Entry* first, const Entry* last,
+                          int64_t minX, int64_t maxX, int64_t minY, int64_t maxY, Fn& fn) {
+        const int64_t baseX = cx * CHUNK_SIZE;
+        const int64_t baseY = cy * CHUNK_SIZE;
+        const uint32_t lx0 = static_cast<uint32_t>(std::max<int64_t>(minX - baseX, 0));
+        const uint32_t lx1 = static_cast<uint32_t>(std::min<int64_t>(maxX - baseX, CHUNK_SIZE - 1));
+        const uint32_t ly0 = static_cast<uint32_t>(std::max<int64_t>(minY - baseY, 0));
+        const uint32_t ly1 = static_cast<uint32_t>(std::min<int64_t>(maxY - baseY, CHUNK_SIZE - 1));
+
+        // Клетки строки квадрата - непрерывный диапазон локальных индексов
+        const Entry* e = first;
+        for (uint32_t ly = ly0; ly <= ly1 && e != last; ++ly) {
+            const uint32_t lo = (ly << CHUNK_SHIFT) | lx0;
+            const uint32_t hi = (ly << CHUNK_SHIFT) | lx1;
+            e = std::lower_bound(e, last, lo, [](const Entry& entry, uint32_t cell) {
+                return entry.cell < cell;
+            });
+            for (; e != last && e->cell <= hi; ++e) {
+                if (e->id != NONE) fn(e->id);
+            }
+        }
+    }
+
+    bool findChunk(int chunkX, int chunkY, const Entry*& first, const Entry*& last) const {
+        uint32_t chunk = lookup(chunkKey(chunkX, chunkY));
+        if (chunk == NONE) return false;
+        first = entries.data() + chunkStart[chunk];
+        last = entries.data() + chunkStart[chunk + 1];
+        return true;
+    }
+
+    std::vector<uint64_t> chunkKeys;    // непустые чанки в порядке появления
+    std::vector<uint32_t> chunkStart;   // начало чанка в entries, +1 в конце
+    std::vector<uint64_t> tableKeys;    // открытая адресация, линейное пробирование
+    std::vector<uint32_t> tableValues;  // номер чанка в chunkKeys
+    size_t tableMask = 0;
+    int minChunkX = 0;  // границы занятых чанков
+    int maxChunkX = -1;
+    int minChunkY = 0;
+    int maxChunkY = -1;
+    std::vector<Entry> entries;
+    std::vector<uint32_t> entryOf;      // по id: позиция в entries или NONE
+    size_t live = 0;
+
+    // Буферы перестройки
+    std::vector<uint32_t> slotChunk;
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> fill;
+};
+
+#endif
@@ -0,0 +1,36 @@
+#include "spatial_grid.h"
+#include "alive_bitset.h"
+#include <algorithm>
+#include <numeric>
+
+SpatialGrid::SpatialGrid(const std::vector<std::shared_ptr<NPC>>& npcs, int range)
+    : range(std::max(range, 0)), xs(npcs.size()), ys(npcs.size()) {
+    AliveBitset alive;
+    alive.reserve(npcs.size());
+    for (size_t i = 0; i < npcs.size(); ++i) {
+        xs[i] = npcs[i]->getX();
+        ys[i] = npcs[i]->getY();
+        alive.pushBack(npcs[i]->isAlive());
+    }
+    std::vector<uint32_t> ids(npcs.size());
+    std::iota(ids.begin(), ids.end(), 0u);
+    grid.rebuild(ids.data(), xs.data(), ys.data(), alive.data(), npcs.size());
+}
+
+void SpatialGrid::collectCandidates(size_t i, std::vector<uint32_t>& out) const {
+    out.clear();
+    if (!grid.contains(static_cast<uint32_t>(i))) return;
+
+    grid.forEachInSquare(xs[i], ys[i], range, [&](uint32_t j) {
+        if (j > i) out.push_back(j);
+    });
+    std::sort(out.begin(), out.end());
+}
+
+int SpatialGrid::getRange() const {
+    return range;
+}
+
+size_t SpatialGrid::getChunkCount() const {
+    return grid.chunkCount();
+}
@@ -0,0 +1,30 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include "npc.h"
+#include "sparse_grid.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Поиск соседей для боя поверх разреженной сетки SparseGrid: хранятся только
+// непустые чанки, поэтому память растет с числом NPC, а не с размахом их
+// координат, и ячейки не приходится укрупнять на разреженных картах.
+class SpatialGrid {
+public:
+    SpatialGrid(const std::vector<std::shared_ptr<NPC>>& npcs, int range);
+
+    // Индексы j > i в квадрате range вокруг i, по возрастанию (порядок как у перебора i<j)
+    void collectCandidates(size_t i, std::vector<uint32_t>& out) const;
+
+    int getRange() const;
+    size_t getChunkCount() const;
+
+private:
+    int range;
+    std::vector<int32_t> xs;
+    std::vector<int32_t> ys;
+    SparseGrid grid;
+};
+
+#endif
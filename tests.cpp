@@ -1,7 +1,15 @@
 #include "gtest/gtest.h"
 #include "dungeon_editor.h"
 #include "factory.h"
+#include "dungeon_snapshot.h"
+#include "dungeon_parser.h"
+#include "thread_pool.h"
+#include "name_table.h"
+#include "npc_arena.h"
 #include "game_engine.h"
+#include "world_frame.h"
+#include "map_renderer.h"
+#include "world_config.h"
 #include <fstream>
 #include <filesystem>
 #include <thread>
@@ -9,7 +17,18 @@
 #include "visitor.h"        
 #include "observer.h"       
 #include "game_constants.h" 
+#include "sparse_grid.h"
+#include "tick_profiler.h"
+#include "npc_world.h"
+#include "alive_bitset.h"
+#include "simd_kernels.h"
+#include "tiled_combat.h"
+#include "mpmc_ring_buffer.h"
 #include <random>           
+#include <algorithm>
+#include <tuple>
+#include <atomic>
+#include <sstream>
 
 class DungeonEditorTest : public ::testing::Test {
 protected:
@@ -138,6 +157,282 @@ TEST_F(DungeonEditorTest, NPCDeath) {
     EXPECT_FALSE(npc->isAlive());
 }
 
+TEST_F(DungeonEditorTest, SnapshotRoundTripAndFormatDetection) {
+    DungeonEditor editor;
+    editor.addNPC(NPCType::Bear, 10, 20, "Bear with spaces");
+    editor.addNPC(NPCType::Werewolf, 0, 500, "Wolf");
+    editor.addNPC(NPCType::Rogue, 500, 0, "");
+    editor.addNPC(NPCType::Rogue, 7, 7, "Dead");
+    editor.getNPCs()[3]->markDead();
+    editor.saveSnapshot("test_snapshot.bin");
+    
+    {
+        // Имена читаются прямо из отображенного файла
+        DungeonSnapshot snapshot("test_snapshot.bin");
+        ASSERT_EQ(snapshot.size(), 3u);
+        EXPECT_EQ(snapshot.type(1), NPCType::Werewolf);
+        EXPECT_EQ(snapshot.record(1).y, 500);
+        EXPECT_EQ(snapshot.name(0), "Bear with spaces");
+        EXPECT_TRUE(snapshot.name(2).empty());
+    }
+    
+    DungeonEditor loaded;
+    loaded.load("test_snapshot.bin");
+    ASSERT_EQ(loaded.getNPCs().size(), 3u);
+    EXPECT_EQ(loaded.getNPCs()[0]->getName(), "Bear with spaces");
+    EXPECT_EQ(loaded.getNPCs()[2]->getType(), NPCType::Rogue);
+    EXPECT_EQ(loaded.getNPCs()[2]->getX(), 500);
+    
+    // Текстовый формат по-прежнему загружается тем же load
+    loaded.save("test_snapshot.txt");
+    EXPECT_FALSE(DungeonSnapshot::isSnapshot("test_snapshot.txt"));
+    DungeonEditor fromText;
+    fromText.load("test_snapshot.txt");
+    EXPECT_EQ(fromText.getNPCs().size(), 3u);
+    
+    // Обрезанный снимок отвергается
+    std::ofstream("test_snapshot.bin", std::ios::binary | std::ios::trunc).write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    EXPECT_THROW(loaded.load("test_snapshot.bin"), std::runtime_error);
+    
+    std::remove("test_snapshot.bin");
+    std::remove("test_snapshot.txt");
+}
+
+TEST_F(DungeonEditorTest, SnapshotRejectsWrappedStringTable) {
+    DungeonEditor editor;
+    editor.addNPC(NPCType::Bear, 1, 2, "Bear");
+    editor.saveSnapshot("test_wrapped.bin");
+    
+    // offset + size переполняет uint64_t и дает маленькое число
+    {
+        std::fstream file("test_wrapped.bin", std::ios::binary | std::ios::in | std::ios::out);
+        SnapshotHeader header;
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        header.stringTableSize = ~uint64_t(0) - header.stringTableOffset + 2;
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+    
+    try {
+        DungeonSnapshot snapshot("test_wrapped.bin");
+        FAIL() << "wrapped string table accepted";
+    } catch (const std::runtime_error& e) {
+        EXPECT_EQ(std::string(e.what()).rfind("Corrupted snapshot", 0), 0u) << e.what();
+    }
+    std::remove("test_wrapped.bin");
+}
+
+TEST_F(DungeonEditorTest, SnapshotWriterRejectsTruncatedFields) {
+    // Четыре миллиарда NPC в тесте не создать: проверяем пределы напрямую
+    const uint64_t max32 = UINT32_MAX;
+    EXPECT_NO_THROW(DungeonSnapshot::checkLimits(max32, max32));
+    EXPECT_THROW(DungeonSnapshot::checkLimits(max32 + 1, 0), std::runtime_error);
+    EXPECT_THROW(DungeonSnapshot::checkLimits(1, max32 + 1), std::runtime_error);
+}
+
+TEST_F(DungeonEditorTest, TextParserReportsLinesAndStreamsBlocks) {
+    std::vector<std::shared_ptr<NPC>> npcs;
+    ParseError error;
+    EXPECT_TRUE(parseDungeon("Bear 1 2 Big Bear\r\n\nRogue -3 4\nWerewolf 5 6 W", npcs, error));
+    ASSERT_EQ(npcs.size(), 3u);
+    EXPECT_EQ(npcs[0]->getName(), "Big Bear");
+    EXPECT_EQ(npcs[1]->getX(), -3);
+    EXPECT_EQ(npcs[1]->getName(), "");
+    EXPECT_EQ(npcs[2]->getType(), NPCType::Werewolf);
+    
+    npcs.clear();
+    EXPECT_FALSE(parseDungeon("Bear 1 2 A\nRogue 3 4 B\nDragon 5 6 C\n", npcs, error));
+    EXPECT_EQ(error.line, 3u);
+    EXPECT_EQ(error.message, "Unknown NPC type: Dragon");
+    EXPECT_EQ(npcs.size(), 2u);
+    
+    EXPECT_FALSE(parseDungeon("Bear 1x 2 A", npcs, error));
+    EXPECT_EQ(error.line, 1u);
+    EXPECT_EQ(error.message, "Invalid NPC data format");
+    
+    // Грамматика прежнего разбора через поток: '+' у чисел, имя сразу после y,
+    // ошибка формата раньше неизвестного типа
+    npcs.clear();
+    EXPECT_TRUE(parseDungeon("Bear +1 -2Name\nRogue\t3 4", npcs, error));
+    ASSERT_EQ(npcs.size(), 2u);
+    EXPECT_EQ(npcs[0]->getX(), 1);
+    EXPECT_EQ(npcs[0]->getName(), "Name");
+    EXPECT_EQ(npcs[1]->getY(), 4);
+    EXPECT_FALSE(parseDungeon("Dragon x 1", npcs, error));
+    EXPECT_EQ(error.message, "Invalid NPC data format");
+    EXPECT_FALSE(parseDungeon("Bear 99999999999 1", npcs, error));
+    EXPECT_EQ(error.message, "Invalid NPC data format");
+    
+    // Блок меньше строки: хвосты переносятся, буфер растет
+    {
+        std::ofstream file("test_parser.txt", std::ios::binary);
+        for (int i = 0; i < 50; ++i) {
+            file << "Rogue " << i << " " << i * 2 << " Rogue_with_a_rather_long_name_" << i << "\n";
+        }
+        file << "Bear 1";
+    }
+    npcs.clear();
+    EXPECT_FALSE(parseDungeonFile("test_parser.txt", npcs, error, 8));
+    EXPECT_EQ(error.line, 51u);
+    ASSERT_EQ(npcs.size(), 50u);
+    EXPECT_EQ(npcs[49]->getY(), 98);
+    EXPECT_EQ(npcs[49]->getName(), "Rogue_with_a_rather_long_name_49");
+    EXPECT_THROW(NPCFactory::loadFromFile("test_parser.txt"), std::runtime_error);
+    std::remove("test_parser.txt");
+    
+    EXPECT_FALSE(parseDungeonFile("no_such_dungeon.txt", npcs, error));
+    EXPECT_EQ(error.line, 0u);
+}
+
+TEST_F(DungeonEditorTest, DeltaSaveAppendsJournalAndCompacts) {
+    const std::string path = "test_delta.bin";
+    DungeonEditor editor;
+    for (int i = 0; i < 100; ++i) {
+        editor.addNPC(NPCType::Werewolf, i * 5, 0, "Wolf" + std::to_string(i));
+    }
+    EXPECT_THROW(editor.saveDelta(), std::runtime_error);
+    editor.compact(path);
+    const auto baseSize = std::filesystem::file_size(path);
+    EXPECT_EQ(editor.pendingChanges(), 0u);
+    
+    editor.moveNPC(3, 400, 400);
+    editor.addNPC(NPCType::Bear, 401, 401, "Bear");  // убивает Wolf3 рядом
+    editor.battle(5);
+    ASSERT_FALSE(editor.getNPCs()[3]->isAlive());
+    editor.saveDelta();
+    // Move + Kill + Add с именем, остальные 99 NPC не переписываются
+    EXPECT_EQ(std::filesystem::file_size(path), baseSize + 3 * sizeof(JournalEntry) + 4);
+    
+    // Оборванная запись в конце журнала игнорируется и затирается
+    std::ofstream(path, std::ios::binary | std::ios::app).write("\x02\x00\x00", 3);
+    DungeonEditor loaded;
+    loaded.load(path);
+    ASSERT_EQ(loaded.getNPCs().size(), 101u);
+    EXPECT_FALSE(loaded.getNPCs()[3]->isAlive());
+    EXPECT_EQ(loaded.getNPCs()[3]->getX(), 400);
+    EXPECT_EQ(loaded.getNPCs()[100]->getName(), "Bear");
+    
+    loaded.moveNPC(0, 1, 1);
+    loaded.saveDelta();
+    EXPECT_EQ(std::filesystem::file_size(path), baseSize + 4 * sizeof(JournalEntry) + 4);
+    
+    loaded.compact(path);
+    EXPECT_EQ(loaded.getNPCs().size(), 100u);
+    DungeonEditor compacted;
+    compacted.load(path);
+    ASSERT_EQ(compacted.getNPCs().size(), 100u);
+    EXPECT_EQ(compacted.getNPCs()[0]->getX(), 1);
+    EXPECT_EQ(compacted.getNPCs()[99]->getName(), "Bear");
+    
+    std::remove(path.c_str());
+}
+
+TEST_F(DungeonEditorTest, SaveSnapshotOverDeltaBaseDetachesJournal) {
+    const std::string path = "test_delta_base.bin";
+    DungeonEditor editor;
+    editor.addNPC(NPCType::Rogue, 0, 0, "Dead");
+    editor.addNPC(NPCType::Werewolf, 10, 10, "Wolf");
+    editor.addNPC(NPCType::Rogue, 20, 20, "Rogue");
+    editor.compact(path);
+    
+    // Мертвый NPC выпадает из файла, но не из редактора: индексы прежние
+    editor.getNPCs()[0]->markDead();
+    editor.saveSnapshot(path);
+    ASSERT_EQ(editor.getNPCs().size(), 3u);
+    EXPECT_EQ(editor.getNPCs()[1]->getName(), "Wolf");
+    EXPECT_THROW(editor.saveDelta(), std::runtime_error);
+    
+    // Сдвиг индексов - только по явному compact
+    editor.compact(path);
+    ASSERT_EQ(editor.getNPCs().size(), 2u);
+    
+    // Двигается тот же объект: указатели из getNPCs остаются действительными
+    const NPC* moved = editor.getNPCs()[1].get();
+    editor.moveNPC(1, 30, 30);
+    EXPECT_EQ(editor.getNPCs()[1].get(), moved);
+    EXPECT_EQ(moved->getX(), 30);
+    editor.saveDelta();
+    
+    DungeonEditor loaded;
+    loaded.load(path);
+    ASSERT_EQ(loaded.getNPCs().size(), 2u);
+    EXPECT_EQ(loaded.getNPCs()[0]->getName(), "Wolf");
+    EXPECT_EQ(loaded.getNPCs()[0]->getX(), 10);
+    EXPECT_EQ(loaded.getNPCs()[1]->getName(), "Rogue");
+    EXPECT_EQ(loaded.getNPCs()[1]->getX(), 30);
+    EXPECT_TRUE(loaded.getNPCs()[1]->isAlive());
+    
+    std::remove(path.c_str());
+}
+
+TEST(NameTableTest, NamesAreSharedAcrossFactoryWorldAndThreads) {
+    NameTable& table = NameTable::global();
+    auto bear = NPCFactory::create(NPCType::Bear, 1, 1, "Interned Bear");
+    auto copy = NPCFactory::create(NPCType::Rogue, 2, 2, std::string("Interned ") + "Bear");
+    EXPECT_EQ(bear->getNameId(), copy->getNameId());
+    EXPECT_EQ(&bear->getName(), &copy->getName());
+    
+    NPCWorld world;
+    NPCHandle h = world.spawn(*bear);
+    EXPECT_EQ(world.getNameId(h), bear->getNameId());
+    EXPECT_EQ(world.toNPC(h)->getName(), "Interned Bear");
+    
+    // Параллельное интернирование одних и тех же имен дает одинаковые ID
+    std::vector<std::vector<NameId>> ids(4);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < ids.size(); ++t) {
+        threads.emplace_back([&ids, &table, t]() {
+            for (int i = 0; i < 1000; ++i) {
+                ids[t].push_back(table.intern("Concurrent_" + std::to_string(i)));
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    for (size_t t = 1; t < ids.size(); ++t) {
+        EXPECT_EQ(ids[t], ids[0]);
+    }
+    EXPECT_EQ(table.resolve(ids[0][999]), "Concurrent_999");
+    
+    // Пакет: известные и новые имена, повторы внутри пакета
+    std::string_view batch[] = {"Concurrent_5", "Batch new", "Interned Bear", "Batch new"};
+    NameId batchIds[4];
+    table.intern(batch, 4, batchIds);
+    EXPECT_EQ(batchIds[0], ids[0][5]);
+    EXPECT_EQ(batchIds[1], batchIds[3]);
+    EXPECT_EQ(batchIds[2], bear->getNameId());
+    EXPECT_EQ(table.intern("Batch new"), batchIds[1]);
+}
+
+TEST(NPCArenaTest, RecyclesDeadSlotsAndReleasesAtOnce) {
+    NPCArena arena(64);
+    NameId name = NameTable::global().intern("Pooled");
+    std::vector<std::shared_ptr<NPC>> npcs;
+    for (int i = 0; i < 1000; ++i) {
+        npcs.push_back(NPCFactory::create(static_cast<NPCType>(i % 3), i, i, name, arena));
+    }
+    auto full = arena.getStats();
+    EXPECT_EQ(full.liveBlocks, 1000u);
+    EXPECT_EQ(npcs[999]->getX(), 999);
+    EXPECT_EQ(npcs[997]->getType(), NPCType::Werewolf);
+    
+    // Убираем каждого второго и создаем столько же: новые занимают освобожденные блоки
+    for (size_t i = 0; i < npcs.size(); i += 2) npcs[i].reset();
+    EXPECT_EQ(arena.getStats().freeBlocks, 500u);
+    for (size_t i = 0; i < npcs.size(); i += 2) {
+        npcs[i] = NPCFactory::create(NPCType::Rogue, 0, 0, name, arena);
+    }
+    auto reused = arena.getStats();
+    EXPECT_EQ(reused.slabs, full.slabs);
+    EXPECT_EQ(reused.reservedBytes, full.reservedBytes);
+    EXPECT_EQ(reused.freeBlocks, 0u);
+    
+    EXPECT_THROW(arena.release(), std::runtime_error);
+    npcs.clear();
+    arena.release();
+    EXPECT_EQ(arena.getStats().slabs, 0u);
+    EXPECT_EQ(arena.getStats().reservedBytes, 0u);
+}
+
 TEST(GameEngineTest, Initialization) {
     GameEngine engine;
     
@@ -155,6 +450,344 @@ TEST(GameEngineTest, Initialization) {
     SUCCEED();
 }
 
+TEST(GameEngineTest, HeadlessStepIsReproducible) {
+    // Один seed, разное число потоков: одинаковый мир после тех же тиков
+    GameEngine serial(1, 12345);
+    GameEngine parallel(4, 12345);
+    StepStats serialStats = serial.step(200);
+    StepStats parallelStats = parallel.step(200);
+    
+    EXPECT_EQ(serialStats.ticks, 200u);
+    EXPECT_GT(serialStats.ticksPerSecond, 0.0);
+    EXPECT_EQ(serialStats.survivors, parallelStats.survivors);
+    
+    auto a = serial.snapshotNPCs();
+    auto b = parallel.snapshotNPCs();
+    ASSERT_EQ(a.size(), b.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+        EXPECT_EQ(a[i]->isAlive(), b[i]->isAlive());
+        EXPECT_EQ(a[i]->getX(), b[i]->getX());
+        EXPECT_EQ(a[i]->getY(), b[i]->getY());
+    }
+}
+
+TEST(GameEngineTest, LargeMapCombatIsReproducibleAcrossWorkers) {
+    // Много плиток в каждой фазе боя: соседние слоты разных плиток делят
+    // слова флагов жизни
+    WorldConfig config;
+    config.mapWidth = 1000;
+    config.mapHeight = 1000;
+    config.npcCount = 20000;
+    
+    std::ostringstream sink;
+    std::streambuf* saved = std::cout.rdbuf(sink.rdbuf());
+    config.workerThreads = 1;
+    GameEngine serial(config, 777);
+    StepStats serialStats = serial.step(10);
+    serial.stop();
+    config.workerThreads = 4;
+    GameEngine parallel(config, 777);
+    StepStats parallelStats = parallel.step(10);
+    parallel.stop();
+    std::cout.rdbuf(saved);
+    
+    EXPECT_LT(serialStats.survivors, 20000u);
+    EXPECT_EQ(serialStats.survivors, parallelStats.survivors);
+    auto a = serial.currentFrame();
+    auto b = parallel.currentFrame();
+    ASSERT_EQ(a->size(), b->size());
+    EXPECT_TRUE(a->x == b->x);
+    EXPECT_TRUE(a->y == b->y);
+}
+
+TEST(GameEngineTest, PublishedFrameStaysImmutableWhileTicking) {
+    GameEngine engine(2, 777);
+    auto initial = engine.currentFrame();
+    EXPECT_EQ(initial->tick, 0u);
+    EXPECT_EQ(initial->size(), static_cast<size_t>(INITIAL_NPC_COUNT));
+
+    // Держим кадр, пока мир уходит вперед: его содержимое не меняется
+    engine.step(5);
+    auto held = engine.currentFrame();
+    std::vector<int32_t> heldX = held->x;
+    uint64_t heldEpoch = held->epoch;
+    EXPECT_EQ(held->tick, 5u);
+    EXPECT_EQ(engine.frameEpoch(), heldEpoch);
+
+    StepStats stats = engine.step(20);
+    auto latest = engine.currentFrame();
+    EXPECT_EQ(held->x, heldX);
+    EXPECT_EQ(held->tick, 5u);
+    EXPECT_EQ(latest->tick, 25u);
+    EXPECT_EQ(latest->epoch, heldEpoch + 20);
+    EXPECT_EQ(latest->size(), stats.survivors);
+    EXPECT_EQ(engine.snapshotNPCs().size(), latest->size());
+}
+
+TEST(GameEngineTest, FramePublisherReusesReleasedBuffers) {
+    NPCWorld world;
+    world.spawn(NPCType::Bear, 1, 2, "A");
+    NPCHandle dead = world.spawn(NPCType::Rogue, 3, 4, "B");
+    world.spawn(NPCType::Werewolf, 5, 6, "C");
+    world.markDead(dead);
+
+    FramePublisher frames;
+    for (uint32_t t = 1; t <= 4; ++t) {
+        frames.acquire().capture(world, t);
+        frames.publish();
+    }
+    // Никто не держал кадры - хватило двух буферов
+    EXPECT_EQ(frames.reallocations(), 0u);
+    EXPECT_EQ(frames.epoch(), 4u);
+
+    auto frame = frames.current();
+    ASSERT_EQ(frame->size(), 2u);
+    EXPECT_EQ(frame->tick, 4u);
+    EXPECT_EQ(frame->type[1], NPCType::Werewolf);
+    EXPECT_EQ(frame->x[1], 5);
+    EXPECT_EQ(frame->toNPC(0)->getName(), "A");
+
+    // Читатель держит оба буфера - писатель не ждет, а берет новый
+    auto older = frame;
+    frames.acquire().capture(world, 5);
+    frames.publish();
+    auto newer = frames.current();
+    frames.acquire().capture(world, 6);
+    frames.publish();
+    EXPECT_EQ(frames.reallocations(), 1u);
+    EXPECT_EQ(older->tick, 4u);
+    EXPECT_EQ(newer->tick, 5u);
+    EXPECT_EQ(frames.current()->tick, 6u);
+}
+
+TEST(GameEngineTest, ProfileCoversTickPhasesWhenEnabled) {
+    GameEngine engine(2, 5);
+#ifdef RPG_PROFILING
+    engine.setMetricsOutput("test_engine_metrics.json");
+    StepStats stats = engine.step(12);
+    engine.stop();
+    ProfileSnapshot profile = engine.getProfile();
+    EXPECT_EQ(profile.ticks, 12u);
+    EXPECT_EQ(profile.phases[static_cast<size_t>(TickPhase::Tick)].count, 12u);
+    EXPECT_EQ(profile.phases[static_cast<size_t>(TickPhase::Combat)].count, 12u);
+    EXPECT_EQ(profile.kills, INITIAL_NPC_COUNT - stats.survivors);
+    EXPECT_GE(profile.locks[static_cast<size_t>(ProfiledLock::Cout)].count, 1u);
+    engine.exportMetrics();
+    EXPECT_TRUE(std::filesystem::exists("test_engine_metrics.json"));
+    std::remove("test_engine_metrics.json");
+#else
+    // Без RPG_PROFILING замеров нет, а экспорт запрещен явно
+    engine.step(3);
+    EXPECT_EQ(engine.getProfile().ticks, 0u);
+    EXPECT_THROW(engine.setMetricsOutput("metrics.prom"), std::runtime_error);
+#endif
+}
+
+TEST(TickProfilerTest, AggregatesThreadsAndExportsFormats) {
+    TickProfiler profiler;
+    std::thread worker([&] {
+        profiler.recordPhase(TickPhase::Move, 1000);
+        profiler.recordTick(0, 3, 2);
+    });
+    worker.join();
+    profiler.recordPhase(TickPhase::Move, 3000000);
+    profiler.recordTick(1, 0, 5);
+    std::mutex mutex;
+    {
+        auto lock = profiler.lock(mutex, ProfiledLock::Cout);
+        EXPECT_TRUE(lock.owns_lock());
+    }
+    
+    // Потоки складываются; последний тик - с наибольшим номером
+    ProfileSnapshot s = profiler.snapshot();
+    const TimerSummary& move = s.phases[static_cast<size_t>(TickPhase::Move)];
+    EXPECT_EQ(move.count, 2u);
+    EXPECT_EQ(move.totalNs, 3001000u);
+    EXPECT_EQ(move.maxNs, 3000000u);
+    EXPECT_EQ(move.buckets[2], 1u);   // 1000 нс < 2^10
+    EXPECT_EQ(move.buckets[14], 1u);  // 3 мс < 2^22 нс
+    EXPECT_EQ(s.locks[0].count, 1u);
+    EXPECT_EQ(s.ticks, 2u);
+    EXPECT_EQ(s.kills, 3u);
+    EXPECT_EQ(s.lastTickKills, 0u);
+    EXPECT_EQ(s.queueDepth, 5u);
+    EXPECT_EQ(s.maxKillsPerTick, 3u);
+    EXPECT_EQ(s.killBuckets[0], 1u);
+    EXPECT_EQ(s.killBuckets[2], 1u);
+    
+    EXPECT_EQ(metricsFormatFor("m.json"), MetricsFormat::Json);
+    EXPECT_EQ(metricsFormatFor("m.csv"), MetricsFormat::Csv);
+    EXPECT_EQ(metricsFormatFor("rpg.prom"), MetricsFormat::Prometheus);
+    std::ostringstream json, csv, prom;
+    writeMetrics(json, s, MetricsFormat::Json);
+    writeMetrics(csv, s, MetricsFormat::Csv);
+    writeMetrics(prom, s, MetricsFormat::Prometheus);
+    EXPECT_NE(json.str().find("\"move\": {\"count\": 2"), std::string::npos);
+    EXPECT_NE(csv.str().find("phase,move,2,3.001,"), std::string::npos);
+    EXPECT_NE(prom.str().find("rpg_tick_phase_seconds_count{phase=\"move\"} 2"), std::string::npos);
+    EXPECT_NE(prom.str().find("rpg_kills_per_tick_bucket{le=\"+Inf\"} 2"), std::string::npos);
+    
+    const std::string path = "test_metrics.prom";
+    writeMetricsFile(path, s, MetricsFormat::Prometheus);
+    std::ifstream file(path);
+    std::string written((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(written, prom.str());
+    file.close();
+    std::remove(path.c_str());
+}
+
+TEST(MapRendererTest, PlainFrameDownsamplesAndReportsTime) {
+    NPCWorld world;
+    world.spawn(NPCType::Bear, 0, 0, "A");
+    world.spawn(NPCType::Rogue, 1, 1, "B");
+    world.spawn(NPCType::Rogue, 1, 0, "C");
+    world.spawn(NPCType::Werewolf, 9, 5, "D");
+    WorldFrame frame;
+    frame.capture(world, 3);
+
+    // Карта 10x6 в окне не больше 5x3: один символ на 2x2 клетки
+    MapRenderer renderer(10, 6, 5, 3);
+    EXPECT_EQ(renderer.viewWidth(), 5);
+    EXPECT_EQ(renderer.viewHeight(), 3);
+    std::string text(renderer.render(frame));
+
+    std::vector<std::string> lines;
+    std::istringstream stream(text);
+    for (std::string line; std::getline(stream, line);) lines.push_back(line);
+    ASSERT_EQ(lines.size(), 7u);
+    EXPECT_EQ(lines[1], "=== CURRENT MAP ===");
+    EXPECT_EQ(lines[2], "R....");  // два разбойника против одного медведя
+    EXPECT_EQ(lines[3], ".....");
+    EXPECT_EQ(lines[4], "....W");
+    EXPECT_EQ(lines[6].rfind("Tick 3, 4 alive, frame ", 0), 0u);
+    EXPECT_NE(lines[6].find("1 char = 2x2 cells"), std::string::npos);
+    EXPECT_GE(renderer.lastRenderMs(), 0.0);
+}
+
+TEST(MapRendererTest, AnsiRedrawsOnlyChangedCells) {
+    NPCWorld world;
+    NPCHandle mover = world.spawn(NPCType::Bear, 2, 1, "A");
+    world.spawn(NPCType::Rogue, 7, 3, "B");
+    WorldFrame frame;
+    frame.capture(world, 1);
+
+    MapRenderer renderer(10, 5, 10, 5, RenderMode::Ansi);
+    std::string first(renderer.render(frame));
+    EXPECT_EQ(first.rfind("\x1b[2J", 0), 0u);
+    EXPECT_EQ(renderer.lastChangedCells(), 50u);
+
+    // Медведь сдвинулся на соседнюю клетку: старая клетка и новая - один прогон
+    world.setPosition(mover, 3, 1);
+    frame.capture(world, 2);
+    std::string delta(renderer.render(frame));
+    EXPECT_EQ(renderer.lastChangedCells(), 2u);
+    EXPECT_NE(delta.find("\x1b[3;3H.B"), std::string::npos);
+    EXPECT_EQ(delta.find("\x1b[2J"), std::string::npos);
+    EXPECT_EQ(delta.find("R"), std::string::npos);
+
+    // Без изменений выводится только строка статуса
+    frame.capture(world, 3);
+    std::string idle(renderer.render(frame));
+    EXPECT_EQ(renderer.lastChangedCells(), 0u);
+    EXPECT_NE(idle.find("Tick 3, 2 alive"), std::string::npos);
+
+    EXPECT_EQ(std::string(renderer.finish()).rfind("\x1b[r", 0), 0u);
+    EXPECT_TRUE(renderer.finish().empty());
+}
+
+TEST(WorldConfigTest, ParsesFileAndRejectsBadValues) {
+    const std::string path = "test_world.cfg";
+    {
+        std::ofstream file(path);
+        file << "# большая карта\n";
+        file << "map_width = 4096\n";
+        file << "map_height=2000  # не степень двойки\n";
+        file << "\n";
+        file << "npc_count = 3000\n";
+        file << "tick_rate = 2.5\n";
+    }
+    WorldConfig config = WorldConfig::fromFile(path);
+    EXPECT_EQ(config.mapWidth, 4096);
+    EXPECT_EQ(config.mapHeight, 2000);
+    EXPECT_EQ(config.npcCount, 3000);
+    EXPECT_DOUBLE_EQ(config.tickRate, 2.5);
+    EXPECT_EQ(config.killDistance, KILL_DISTANCE);
+    EXPECT_TRUE(config.contains(4095, 1999));
+    EXPECT_FALSE(config.contains(4096, 0));
+
+    {
+        std::ofstream file(path);
+        file << "map_width = 0\n";
+    }
+    EXPECT_THROW(WorldConfig::fromFile(path), std::runtime_error);
+    {
+        std::ofstream file(path);
+        file << "map_size = 100\n";
+    }
+    EXPECT_THROW(WorldConfig::fromFile(path), std::runtime_error);
+    EXPECT_THROW(config.set("npc_count", "12abc"), std::runtime_error);
+    std::remove(path.c_str());
+
+    config.set("move_distance", "40000");
+    EXPECT_THROW(config.validate(), std::runtime_error);
+    EXPECT_THROW(GameEngine(config, 1), std::runtime_error);
+}
+
+TEST(WorldConfigTest, ValidateBoundsTickRateAndWorkerThreads) {
+    WorldConfig config;
+    config.set("tick_rate", "inf");
+    EXPECT_THROW(config.validate(), std::runtime_error);
+    config.set("tick_rate", "nan");
+    EXPECT_THROW(config.validate(), std::runtime_error);
+    config.tickRate = MAX_TICK_RATE_HZ * 2;
+    EXPECT_THROW(config.validate(), std::runtime_error);
+    config.tickRate = MAX_TICK_RATE_HZ;
+    EXPECT_NO_THROW(config.validate());
+    
+    // Опечатка не должна запускать сто тысяч потоков
+    config.set("worker_threads", "100000");
+    EXPECT_THROW(config.validate(), std::runtime_error);
+    EXPECT_THROW(GameEngine(config, 1), std::runtime_error);
+    config.workerThreads = MAX_WORKER_THREADS;
+    EXPECT_NO_THROW(config.validate());
+}
+
+TEST(WorldConfigTest, EditorAndEngineShareMapBounds) {
+    WorldConfig config;
+    config.mapWidth = 2048;
+    config.mapHeight = 1500;
+    config.npcCount = 2000;
+    config.workerThreads = 2;
+
+    // Координаты за прежним пределом 500 допустимы, если их допускает карта
+    DungeonEditor editor(config);
+    editor.addNPC(NPCType::Bear, 2047, 1499, "Corner");
+    EXPECT_THROW(editor.addNPC(NPCType::Bear, 2048, 0, "Outside"), std::runtime_error);
+    editor.save("test_world_save.txt");
+
+    // Тот же файл в редакторе с картой по умолчанию - ошибка, а не обрезание
+    DungeonEditor small;
+    EXPECT_THROW(small.load("test_world_save.txt"), std::runtime_error);
+    EXPECT_TRUE(small.getNPCs().empty());
+    DungeonEditor wide(config);
+    wide.load("test_world_save.txt");
+    ASSERT_EQ(wide.getNPCs().size(), 1u);
+    EXPECT_EQ(wide.getNPCs()[0]->getX(), 2047);
+    std::remove("test_world_save.txt");
+
+    GameEngine engine(config, 99);
+    engine.step(10);
+    auto frame = engine.currentFrame();
+    EXPECT_EQ(engine.getConfig().mapWidth, 2048);
+    EXPECT_GT(frame->size(), 0u);
+    bool beyondOldMap = false;
+    for (size_t i = 0; i < frame->size(); ++i) {
+        ASSERT_TRUE(config.contains(frame->x[i], frame->y[i]));
+        beyondOldMap |= frame->x[i] >= MAP_WIDTH || frame->y[i] >= MAP_HEIGHT;
+    }
+    EXPECT_TRUE(beyondOldMap);
+}
+
 TEST(NPCTest, MovementWithinBounds) {
     std::mt19937 rng(42);
     auto npc = NPCFactory::create(NPCType::Bear, 50, 50, "Test");
@@ -212,6 +845,652 @@ TEST(VisitorTest, CanKillRules) {
     EXPECT_FALSE(visitor.canKill(NPCType::Rogue, NPCType::Rogue));
 }
 
+TEST(KillMatrixTest, OutcomeIsSymmetricAndMatchesRules) {
+    for (size_t a = 0; a < NPC_TYPE_COUNT; ++a) {
+        for (size_t b = 0; b < NPC_TYPE_COUNT; ++b) {
+            auto ta = static_cast<NPCType>(a);
+            auto tb = static_cast<NPCType>(b);
+            uint8_t outcome = fightOutcome(ta, tb);
+            EXPECT_EQ((outcome & FIGHT_A_KILLS) != 0, canKill(ta, tb));
+            EXPECT_EQ((outcome & FIGHT_B_KILLS) != 0, canKill(tb, ta));
+        }
+    }
+    // Тип известен при компиляции, accept вызывает visit с точным типом
+    static_assert(Bear::TYPE == NPCType::Bear && Rogue::TYPE == NPCType::Rogue, "NPCKind::TYPE");
+    Observable observable;
+    NPCVisitor visitor(1, observable);
+    Werewolf wolf(0, 0, "Wolf");
+    static_cast<NPC&>(wolf).accept(visitor);
+    EXPECT_EQ(wolf.getType(), Werewolf::TYPE);
+}
+
+class RecordingObserver : public Observer {
+public:
+    void onKill(const std::string& killer, const std::string& victim) override {
+        kills.push_back(killer + "->" + victim);
+    }
+    std::vector<std::string> kills;
+};
+
+static std::vector<std::shared_ptr<NPC>> makeRandomDungeon(int count, int side, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> posDist(0, side - 1);
+    std::uniform_int_distribution<int> typeDist(0, 2);
+    std::vector<std::shared_ptr<NPC>> npcs;
+    for (int i = 0; i < count; ++i) {
+        npcs.push_back(NPCFactory::create(static_cast<NPCType>(typeDist(rng)),
+                                          posDist(rng), posDist(rng), "NPC_" + std::to_string(i)));
+    }
+    return npcs;
+}
+
+TEST(VisitorTest, SpatialFightMatchesBruteForce) {
+    for (int range : {0, 3, 10, 40}) {
+        auto bruteNpcs = makeRandomDungeon(600, 200, 7);
+        auto gridNpcs = makeRandomDungeon(600, 200, 7);
+        
+        Observable bruteObs, gridObs;
+        auto bruteLog = std::make_shared<RecordingObserver>();
+        auto gridLog = std::make_shared<RecordingObserver>();
+        bruteObs.addObserver(bruteLog);
+        gridObs.addObserver(gridLog);
+        
+        NPCVisitor(range, bruteObs).fightBruteForce(bruteNpcs);
+        NPCVisitor(range, gridObs).fightSpatial(gridNpcs);
+        
+        EXPECT_EQ(bruteLog->kills, gridLog->kills) << "range " << range;
+        for (size_t i = 0; i < bruteNpcs.size(); ++i) {
+            EXPECT_EQ(bruteNpcs[i]->isAlive(), gridNpcs[i]->isAlive());
+        }
+    }
+}
+
+class BatchObserver : public Observer {
+public:
+    void onKills(Span<const KillEvent> batch) override {
+        batches++;
+        kills.insert(kills.end(), batch.begin(), batch.end());
+    }
+    void onMoves(Span<const MoveEvent> batch) override {
+        moves.insert(moves.end(), batch.begin(), batch.end());
+    }
+    void onSpawns(Span<const SpawnEvent> batch) override {
+        spawns.insert(spawns.end(), batch.begin(), batch.end());
+    }
+    unsigned events() const override { return EVENT_KILLS | EVENT_MOVES | EVENT_SPAWNS; }
+    
+    int batches = 0;
+    std::vector<KillEvent> kills;
+    std::vector<MoveEvent> moves;
+    std::vector<SpawnEvent> spawns;
+};
+
+TEST(ObservableTest, BatchesEventsFromThreadsByTick) {
+    NameId a = NameTable::global().intern("BusA");
+    NameId b = NameTable::global().intern("BusB");
+    Observable bus;
+    auto perKill = std::make_shared<RecordingObserver>();
+    auto batched = std::make_shared<BatchObserver>();
+    bus.addObserver(perKill);
+    EXPECT_FALSE(bus.wants(EVENT_MOVES));
+    bus.addObserver(batched);
+    EXPECT_TRUE(bus.wants(EVENT_MOVES));
+    
+    // Два потока пишут в свои буферы; доставка - по возрастанию тика
+    std::thread first([&] {
+        EventWriter out = bus.writer();
+        out.kill({1, 0, 1, a, b, false});
+        out.kill({3, 1, 0, b, a, true});
+        out.move({3, 0, 5, 6});
+    });
+    first.join();
+    std::thread second([&] { bus.record({2, 1, 0, b, a, false}); });
+    second.join();
+    EXPECT_TRUE(batched->kills.empty());
+    
+    bus.flush();
+    ASSERT_EQ(batched->kills.size(), 3u);
+    EXPECT_EQ(batched->batches, 1);
+    EXPECT_EQ(batched->kills[0].tick, 1u);
+    EXPECT_EQ(batched->kills[1].tick, 2u);
+    EXPECT_EQ(batched->kills[2].tick, 3u);
+    ASSERT_EQ(batched->moves.size(), 1u);
+    EXPECT_EQ(batched->moves[0].x, 5);
+    
+    // onKill - адаптер над пачкой: взаимное убийство - два вызова
+    std::vector<std::string> expected = {"BusA->BusB", "BusB->BusA", "BusB->BusA", "BusA->BusB"};
+    EXPECT_EQ(perKill->kills, expected);
+    
+    // Доставленное не повторяется
+    bus.flush();
+    EXPECT_EQ(batched->batches, 1);
+    bus.notifyKill("X", "Y");
+    EXPECT_EQ(perKill->kills.back(), "X->Y");
+}
+
+TEST(FileObserverTest, BatchesAndDrains) {
+    const std::string logName = "test_observer_log.txt";
+    std::remove(logName.c_str());
+    {
+        // Длинный интервал: записи попадают в файл только по flush и в деструкторе
+        FileObserver observer(logName, std::chrono::seconds(10), 16);
+        for (int i = 0; i < 10; ++i) {
+            observer.onKill("Killer" + std::to_string(i), "Victim");
+        }
+        observer.flush();
+        
+        std::ifstream partial(logName);
+        int lines = 0;
+        for (std::string line; std::getline(partial, line);) lines++;
+        EXPECT_EQ(lines, 10);
+        
+        // Больше maxBacklog: onKill ждет писателя, а не теряет записи
+        for (int i = 0; i < 100; ++i) {
+            observer.onKill("Late" + std::to_string(i), "Victim");
+        }
+    }
+    
+    std::ifstream file(logName);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(file, line);) lines.push_back(line);
+    ASSERT_EQ(lines.size(), 110u);
+    EXPECT_NE(lines.front().find(" KILL: Killer0 -> Victim"), std::string::npos);
+    EXPECT_NE(lines.back().find(" KILL: Late99 -> Victim"), std::string::npos);
+    file.close();
+    std::remove(logName.c_str());
+}
+
+TEST(GameEngineTest, ObserversReceiveSpawnsAndKillBatches) {
+    WorldConfig config;
+    config.mapWidth = 40;
+    config.mapHeight = 40;
+    config.npcCount = 200;
+    config.workerThreads = 2;
+    auto observer = std::make_shared<BatchObserver>();
+    size_t survivors = 0;
+    {
+        GameEngine engine(config, 99);
+        engine.addObserver(observer);
+        survivors = engine.step(10).survivors;
+        engine.stop();
+        
+        ASSERT_EQ(observer->spawns.size(), 200u);
+        EXPECT_EQ(observer->spawns[7].name, NameTable::global().intern("NPC_7"));
+        // Перемещения - все живые на каждом тике
+        auto firstTick = std::count_if(observer->moves.begin(), observer->moves.end(),
+                                       [](const MoveEvent& m) { return m.tick == 0; });
+        EXPECT_EQ(firstTick, 200);
+        EXPECT_EQ(observer->moves.back().tick, 9u);
+    }
+    
+    size_t dead = 0;
+    for (size_t i = 0; i < observer->kills.size(); ++i) {
+        dead += observer->kills[i].mutual ? 2 : 1;
+        if (i > 0) {
+            EXPECT_LE(observer->kills[i - 1].tick, observer->kills[i].tick);
+        }
+    }
+    EXPECT_GT(dead, 0u);
+    EXPECT_EQ(200 - dead, survivors);
+}
+
+TEST(GameEngineTest, StepDeliversLastTickBeforeReturning) {
+    WorldConfig config;
+    config.mapWidth = 40;
+    config.mapHeight = 40;
+    config.npcCount = 200;
+    config.workerThreads = 2;
+    const std::string logName = "test_step_log.txt";
+    std::remove(logName.c_str());
+    {
+        auto observer = std::make_shared<BatchObserver>();
+        auto fileLog = std::make_shared<FileObserver>(logName, std::chrono::seconds(10));
+        GameEngine engine(config, 99);
+        engine.addObserver(observer);
+        engine.addObserver(fileLog);
+        
+        // Без stop(): все читается сразу после step()
+        size_t survivors = engine.step(10).survivors;
+        ASSERT_FALSE(observer->moves.empty());
+        EXPECT_EQ(observer->moves.back().tick, 9u);
+        size_t dead = 0;
+        for (const KillEvent& kill : observer->kills) dead += kill.mutual ? 2 : 1;
+        EXPECT_EQ(200 - dead, survivors);
+        
+        fileLog->flush();
+        std::ifstream file(logName);
+        size_t lines = 0;
+        for (std::string line; std::getline(file, line);) lines++;
+        EXPECT_EQ(lines, dead);
+        engine.stop();
+    }
+    std::remove(logName.c_str());
+}
+
+TEST(NPCWorldTest, CompactionKeepsHandlesAndOrder) {
+    NPCWorld world;
+    for (int i = 0; i < 200; ++i) {
+        world.spawn(static_cast<NPCType>(i % 3), i % 100, i / 2, "W" + std::to_string(i));
+    }
+    for (NPCHandle h = 0; h < 200; ++h) {
+        if (h % 4 != 0) world.markDead(h);
+    }
+    world.markDead(0);  // повторная смерть не сбивает счетчик
+    world.markDead(0);
+    EXPECT_EQ(world.aliveCount(), 49u);
+    
+    std::vector<NPCHandle> before;
+    world.forEachAlive([&](NPCHandle h) { before.push_back(h); });
+    ASSERT_EQ(before.size(), 49u);
+    
+    EXPECT_EQ(world.compactIfSparse(), 151u);
+    EXPECT_EQ(world.size(), 49u);
+    EXPECT_EQ(world.handleCount(), 200u);
+    EXPECT_EQ(world.compactIfSparse(), 0u);
+    
+    std::vector<NPCHandle> after;
+    world.forEachAlive([&](NPCHandle h) { after.push_back(h); });
+    EXPECT_EQ(after, before);
+    for (NPCHandle h : after) {
+        EXPECT_EQ(world.getX(h), static_cast<int>(h % 100));
+        EXPECT_EQ(world.getType(h), static_cast<NPCType>(h % 3));
+        EXPECT_EQ(world.handleAt(world.slotOf(h)), h);
+    }
+    // Выброшенный хэндл: мертв, отсутствует, но имя для отчетов доступно
+    EXPECT_FALSE(world.contains(1));
+    EXPECT_FALSE(world.isAlive(1));
+    EXPECT_EQ(world.getName(1), "W1");
+    EXPECT_EQ(world.toNPCs().size(), 49u);
+}
+
+TEST(NPCWorldTest, MoveAllMatchesNPCMove) {
+    auto npcs = makeRandomDungeon(200, MAP_WIDTH, 11);
+    npcs[3]->markDead();
+    
+    NPCWorld world;
+    for (const auto& npc : npcs) {
+        world.spawn(*npc);
+    }
+    
+    // Один и тот же seed: линейный проход мира дает те же позиции, что NPC::move
+    std::mt19937 npcRng(5), worldRng(5);
+    for (int tick = 0; tick < 10; ++tick) {
+        for (auto& npc : npcs) {
+            npc->setRandomEngine(npcRng);
+            npc->move(MAP_WIDTH, MAP_HEIGHT);
+        }
+        world.moveAll(worldRng, MAP_WIDTH, MAP_HEIGHT);
+    }
+    
+    ASSERT_EQ(world.size(), npcs.size());
+    EXPECT_EQ(world.aliveCount(), npcs.size() - 1);
+    for (NPCHandle h = 0; h < world.size(); ++h) {
+        EXPECT_EQ(world.getX(h), npcs[h]->getX());
+        EXPECT_EQ(world.getY(h), npcs[h]->getY());
+        EXPECT_EQ(world.getName(h), npcs[h]->getName());
+    }
+    
+    auto views = world.toNPCs();
+    EXPECT_FALSE(views[3]->isAlive());
+    EXPECT_EQ(views[7]->getType(), npcs[7]->getType());
+}
+
+TEST(NPCWorldTest, BatchMovesDoNotRepeatAcrossTicks) {
+    // Прежний 32-битный счетчик tick * 2 * count повторялся через 2^32 / (2 * count) тиков
+    const uint32_t period = (1u << 31) / 64;
+    auto stepsAt = [](uint32_t tick) {
+        NPCWorld world;
+        for (int i = 0; i < 64; ++i) world.spawn(NPCType::Bear, 500, 500, "N");
+        world.moveAllBatch(0x123456789abcdef0ull, tick, 1000, 1000, 40);
+        return std::vector<int32_t>(world.xData(), world.xData() + world.size());
+    };
+    EXPECT_EQ(stepsAt(3), stepsAt(3));
+    EXPECT_NE(stepsAt(3), stepsAt(3 + period));
+    EXPECT_NE(stepsAt(3), stepsAt(4));
+}
+
+TEST(SimdKernelsTest, AllLevelsMatchScalar) {
+    const size_t n = 1003;  // не кратно ширине векторов, проверяем и хвост
+    std::mt19937 rng(123);
+    std::uniform_int_distribution<int> coord(-300, 300);
+    std::vector<int32_t> xs(n), ys(n);
+    AliveBitset alive;
+    for (size_t i = 0; i < n; ++i) {
+        xs[i] = coord(rng);
+        ys[i] = coord(rng);
+        // Целиком мертвое слово и частично живые слова
+        alive.pushBack(i >= 64 && i < 128 ? false : (i % 7) != 0);
+    }
+    
+    auto run = [&](SimdLevel level) {
+        setSimdLevel(level);
+        std::vector<uint8_t> mask(n);
+        inRangeMask(xs.data(), ys.data(), n, 10, -20, 150 * 150, mask.data());
+        std::vector<int32_t> dx(n), dy(n);
+        randomSteps(makeStreamKey(42), 7, dx.data(), n, MOVE_DISTANCE);
+        randomSteps(makeStreamKey(42), 7 + n, dy.data(), n, MOVE_DISTANCE);
+        std::vector<int32_t> mx = xs, my = ys;
+        applyMoves(mx.data(), my.data(), dx.data(), dy.data(), alive.data(), n, 100, 100);
+        return std::make_tuple(mask, dx, dy, mx, my);
+    };
+    
+    SimdLevel best = detectSimdLevel();
+    auto reference = run(SimdLevel::Scalar);
+    for (SimdLevel level : {SimdLevel::SSE42, SimdLevel::AVX2}) {
+        if (level > best) continue;
+        EXPECT_TRUE(run(level) == reference) << simdLevelName(level);
+    }
+    setSimdLevel(best);
+    
+    for (int32_t step : std::get<1>(reference)) {
+        EXPECT_GE(step, -MOVE_DISTANCE);
+        EXPECT_LE(step, MOVE_DISTANCE);
+    }
+}
+
+static std::vector<KillRecord> runTiledCombat(size_t threads, NPCWorld& world) {
+    const int side = 300;
+    auto npcs = makeRandomDungeon(4000, side, 21);
+    for (const auto& npc : npcs) {
+        world.spawn(*npc);
+    }
+    SparseGrid grid;
+    grid.rebuild(world.handleData(), world.xData(), world.yData(), world.aliveBits(), world.size());
+    ThreadPool pool(threads);
+    TiledCombat combat(KILL_DISTANCE);
+    return combat.resolve(world, grid, pool, makeStreamKey(99), 3);
+}
+
+TEST(TiledCombatTest, ResultDoesNotDependOnThreadCount) {
+    NPCWorld serialWorld, parallelWorld;
+    auto serial = runTiledCombat(1, serialWorld);
+    auto parallel = runTiledCombat(4, parallelWorld);
+    
+    ASSERT_FALSE(serial.empty());
+    ASSERT_EQ(serial.size(), parallel.size());
+    for (size_t k = 0; k < serial.size(); ++k) {
+        EXPECT_EQ(serial[k].killer, parallel[k].killer);
+        EXPECT_EQ(serial[k].victim, parallel[k].victim);
+        EXPECT_EQ(serial[k].mutual, parallel[k].mutual);
+        // Убивать может только тот, кому это разрешено правилами
+        EXPECT_TRUE(NPCVisitor::canKill(serialWorld.getType(serial[k].killer),
+                                        serialWorld.getType(serial[k].victim)));
+        EXPECT_FALSE(serialWorld.isAlive(serial[k].victim));
+    }
+    size_t alive = 0;
+    for (NPCHandle h = 0; h < serialWorld.size(); ++h) {
+        EXPECT_EQ(serialWorld.isAlive(h), parallelWorld.isAlive(h));
+        alive += parallelWorld.isAlive(h);
+    }
+    // Счетчик живых сходится с флагами: убийства не теряются между плитками
+    EXPECT_EQ(parallelWorld.aliveCount(), alive);
+}
+
+TEST(SparseGridTest, StoresOnlyOccupiedChunksAndFindsNeighbours) {
+    // Три группы на карте со стороной в миллион клеток, одна - с отрицательными координатами
+    NPCWorld world;
+    NPCHandle a = world.spawn(NPCType::Bear, 10, 10, "A");
+    NPCHandle b = world.spawn(NPCType::Rogue, 12, 9, "B");
+    NPCHandle c = world.spawn(NPCType::Rogue, 63, 64, "C");   // соседний чанк по диагонали
+    NPCHandle d = world.spawn(NPCType::Werewolf, 999999, 999999, "D");
+    NPCHandle e = world.spawn(NPCType::Werewolf, -3, -70, "E");
+    NPCHandle dead = world.spawn(NPCType::Bear, 11, 11, "Dead");
+    world.markDead(dead);
+
+    SparseGrid grid;
+    grid.rebuild(world.handleData(), world.xData(), world.yData(), world.aliveBits(), world.size());
+    EXPECT_EQ(grid.size(), 5u);
+    EXPECT_EQ(grid.chunkCount(), 4u);
+    EXPECT_FALSE(grid.contains(dead));
+    EXPECT_LT(grid.memoryUsage(), 4096u);
+
+    auto near = [&](int x, int y, int radius) {
+        std::vector<uint32_t> found;
+        grid.forEachInSquare(x, y, radius, [&](uint32_t id) { found.push_back(id); });
+        std::sort(found.begin(), found.end());
+        return found;
+    };
+    EXPECT_EQ(near(10, 10, 2), (std::vector<uint32_t>{a, b}));
+    EXPECT_EQ(near(62, 62, 2), (std::vector<uint32_t>{c}));
+    EXPECT_EQ(near(999998, 1000000, 1), (std::vector<uint32_t>{d}));
+    EXPECT_EQ(near(-1, -69, 2), (std::vector<uint32_t>{e}));
+    EXPECT_TRUE(near(500000, 500000, 1000).empty());
+    // Квадрат шире занятых чанков: обход по списку непустых чанков
+    EXPECT_EQ(near(10, 10, 100), (std::vector<uint32_t>{a, b, c, e}));
+    EXPECT_EQ(near(0, 0, 1 << 20), (std::vector<uint32_t>{a, b, c, d, e}));
+
+    // Чанки в порядке первого появления по слотам, NPC чанка - по клеткам
+    std::vector<std::pair<int, int>> chunks;
+    grid.forEachChunk([&](int cx, int cy) { chunks.emplace_back(cx, cy); });
+    EXPECT_EQ(chunks, (std::vector<std::pair<int, int>>{{0, 0}, {0, 1}, {15624, 15624}, {-1, -2}}));
+    std::vector<uint32_t> inFirst;
+    grid.forEachInChunk(0, 0, [&](uint32_t id, int x, int y) {
+        inFirst.push_back(id);
+        EXPECT_EQ(x, world.getX(id));
+        EXPECT_EQ(y, world.getY(id));
+    });
+    EXPECT_EQ(inFirst, (std::vector<uint32_t>{b, a}));
+
+    grid.remove(b);
+    EXPECT_FALSE(grid.contains(b));
+    EXPECT_EQ(near(10, 10, 2), (std::vector<uint32_t>{a}));
+}
+
+TEST(ThreadPoolTest, DrainRunsNestedWorkAndCancelDropsQueued) {
+    std::atomic<int> sum{0};
+    {
+        ThreadPool pool(4);
+        for (int t = 0; t < 100; ++t) {
+            pool.submit([&pool, &sum]() {
+                // Вложенный parallelFor внутри задачи пула не должен зависать
+                pool.parallelFor(10, [&sum](size_t i) { sum += static_cast<int>(i); });
+            });
+        }
+        pool.shutdown(ThreadPool::ShutdownMode::Drain);
+        
+        ThreadPool::Stats stats = pool.getStats();
+        EXPECT_EQ(stats.queueDepth, 0u);
+        EXPECT_EQ(stats.cancelled, 0u);
+        EXPECT_GE(stats.executed, 100u);
+        EXPECT_THROW(pool.submit([]() {}), std::runtime_error);
+    }
+    EXPECT_EQ(sum, 100 * 45);
+    
+    std::atomic<int> ran{0};
+    ThreadPool single(1);
+    std::atomic<bool> started{false}, release{false};
+    single.submit([&]() {
+        started = true;
+        while (!release) std::this_thread::yield();
+    });
+    while (!started) std::this_thread::yield();
+    for (int t = 0; t < 50; ++t) {
+        single.submit([&ran]() { ran++; });
+    }
+    std::thread unblock([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        release = true;
+    });
+    single.shutdown(ThreadPool::ShutdownMode::Cancel);
+    unblock.join();
+    EXPECT_EQ(ran + static_cast<int>(single.getStats().cancelled), 50);
+}
+
+TEST(ThreadPoolTest, QueueDepthNeverExceedsSubmitted) {
+    // Задачу могут выполнить сразу после постановки: глубина очереди не
+    // должна уходить ниже нуля (в size_t - к SIZE_MAX)
+    ThreadPool pool(2);
+    std::atomic<bool> done{false};
+    std::atomic<size_t> maxDepth{0};
+    std::thread sampler([&]() {
+        while (!done) {
+            size_t depth = pool.getStats().queueDepth;
+            if (depth > maxDepth) maxDepth = depth;
+        }
+    });
+    std::atomic<int> ran{0};
+    std::vector<std::thread> producers;
+    for (int p = 0; p < 2; ++p) {
+        producers.emplace_back([&]() {
+            for (int t = 0; t < 5000; ++t) pool.submit([&ran]() { ran++; });
+        });
+    }
+    for (auto& producer : producers) producer.join();
+    pool.shutdown(ThreadPool::ShutdownMode::Drain);
+    done = true;
+    sampler.join();
+    
+    EXPECT_EQ(ran, 10000);
+    EXPECT_LE(maxDepth, 10000u);
+    EXPECT_EQ(pool.getStats().queueDepth, 0u);
+}
+
+TEST(ThreadPoolTest, SubmitRacingShutdownRunsOrThrows) {
+    // Принятая задача выполняется, отклоненная бросает исключение:
+    // ни одна не теряется в очереди после выхода рабочих
+    for (int round = 0; round < 50; ++round) {
+        ThreadPool pool(2);
+        std::atomic<int> ran{0};
+        std::atomic<int> accepted{0};
+        std::vector<std::thread> producers;
+        for (int p = 0; p < 2; ++p) {
+            producers.emplace_back([&]() {
+                for (int t = 0; t < 200; ++t) {
+                    try {
+                        pool.submit([&ran]() { ran++; });
+                        accepted++;
+                    } catch (const std::runtime_error&) {
+                        return;
+                    }
+                }
+            });
+        }
+        pool.shutdown(ThreadPool::ShutdownMode::Drain);
+        for (auto& producer : producers) producer.join();
+        
+        EXPECT_EQ(ran, accepted);
+        EXPECT_EQ(pool.getStats().queueDepth, 0u);
+    }
+}
+
+TEST(MPMCRingBufferTest, BoundedFifoAndConcurrentTransfer) {
+    MPMCRingBuffer<int> small(3);
+    EXPECT_EQ(small.capacity(), 4u);
+    for (int i = 0; i < 4; ++i) EXPECT_TRUE(small.tryPush(i));
+    EXPECT_FALSE(small.tryPush(4));
+    int value = -1;
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(small.tryPop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(small.tryPop(value));
+    
+    // 4 производителя и 4 потребителя: каждая запись доходит ровно один раз
+    MPMCRingBuffer<KillRecord> ring(64);
+    const uint32_t perProducer = 5000;
+    std::atomic<uint64_t> checksum{0};
+    std::atomic<uint32_t> consumed{0};
+    std::vector<std::thread> threads;
+    for (uint32_t p = 0; p < 4; ++p) {
+        threads.emplace_back([&, p]() {
+            for (uint32_t i = 0; i < perProducer; ++i) {
+                KillRecord record{p, i, false};
+                while (!ring.tryPush(record)) std::this_thread::yield();
+            }
+        });
+        threads.emplace_back([&]() {
+            KillRecord record;
+            while (consumed < 4 * perProducer) {
+                if (ring.tryPop(record)) {
+                    checksum += record.killer * perProducer + record.victim;
+                    consumed++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    
+    uint64_t n = 4ull * perProducer;
+    EXPECT_EQ(consumed, n);
+    EXPECT_EQ(checksum, n * (n - 1) / 2);
+}
+
+TEST(RngStreamTest, StreamsAreReproducibleAndIndependent) {
+    RngStream a(2024, 7), b(2024, 7), other(2024, 8);
+    int differences = 0;
+    for (int i = 0; i < 100; ++i) {
+        uint64_t value = a();
+        EXPECT_EQ(value, b());
+        differences += value != other();
+    }
+    EXPECT_GT(differences, 95);
+    
+    // Значение зависит только от номера: можно перемотать поток
+    RngStream replay(2024, 7);
+    replay.seek(50);
+    RngStream fresh(2024, 7);
+    for (int i = 0; i < 50; ++i) fresh();
+    EXPECT_EQ(replay(), fresh());
+    
+    // У каждого NPC свой поток: порядок обхода не влияет на результат
+    auto forward = makeRandomDungeon(20, 100, 3);
+    auto backward = makeRandomDungeon(20, 100, 3);
+    for (size_t i = 0; i < forward.size(); ++i) {
+        forward[i]->setRandomStream(RngStream(99, i));
+        backward[i]->setRandomStream(RngStream(99, i));
+    }
+    for (int tick = 0; tick < 10; ++tick) {
+        for (auto it = forward.begin(); it != forward.end(); ++it) (*it)->move(100, 100);
+        for (auto it = backward.rbegin(); it != backward.rend(); ++it) (*it)->move(100, 100);
+    }
+    for (size_t i = 0; i < forward.size(); ++i) {
+        EXPECT_EQ(forward[i]->getX(), backward[i]->getX());
+        EXPECT_EQ(forward[i]->getY(), backward[i]->getY());
+        int roll = forward[i]->rollDice();
+        EXPECT_GE(roll, 1);
+        EXPECT_LE(roll, 6);
+    }
+}
+
+TEST_F(DungeonEditorTest, ParallelLoadAndSaveKeepOrder) {
+    auto npcs = makeRandomDungeon(3000, 500, 17);
+    npcs[5]->markDead();
+    
+    std::string text;
+    formatDungeon(npcs, 0, npcs.size(), text);
+    std::vector<std::shared_ptr<NPC>> sequential;
+    ParseError error;
+    ASSERT_TRUE(parseDungeon(text, sequential, error));
+    
+    ThreadPool pool(3);
+    std::vector<std::shared_ptr<NPC>> parallel;
+    ASSERT_TRUE(parseDungeonParallel(text, parallel, error, pool, 512));
+    ASSERT_EQ(parallel.size(), sequential.size());
+    for (size_t i = 0; i < parallel.size(); ++i) {
+        EXPECT_EQ(parallel[i]->getName(), sequential[i]->getName());
+        EXPECT_EQ(parallel[i]->getX(), sequential[i]->getX());
+    }
+    
+    // Сквозной номер строки при ошибке в середине
+    std::string broken = text;
+    size_t lineStart = 0;
+    for (int line = 1; line < 2000; ++line) lineStart = broken.find('\n', lineStart) + 1;
+    broken.replace(lineStart, 0, "Dragon ");
+    parallel.clear();
+    EXPECT_FALSE(parseDungeonParallel(broken, parallel, error, pool, 512));
+    EXPECT_EQ(error.line, 2000u);
+    EXPECT_EQ(parallel.size(), 1999u);
+    
+    // Запись по кускам совпадает с последовательной
+    ASSERT_TRUE(writeDungeonParallel("test_save.txt", npcs, pool, 100));
+    std::ifstream file("test_save.txt", std::ios::binary);
+    std::string written((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(written, text);
+    EXPECT_EQ(NPCFactory::loadFromFile("test_save.txt", pool).size(), npcs.size() - 1);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,197 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// Индекс рабочего текущего потока в его пуле (или SIZE_MAX вне пула)
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local size_t currentWorker = SIZE_MAX;
+
+}
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < threadCount; ++i) {
+        queues.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < threadCount; ++i) {
+        threads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    shutdown(ShutdownMode::Drain);
+}
+
+size_t ThreadPool::size() const {
+    return queues.size();
+}
+
+void ThreadPool::submit(Task task) {
+    // Задачи из рабочего потока идут в его очередь, остальные - по кругу
+    size_t target = (currentPool == this) ? currentWorker
+                                          : nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    {
+        // Проверка и счетчик под sleepMutex, как и stopping в shutdown:
+        // рабочие не выйдут, пока принятая задача не выполнена. Счетчик растет
+        // до того, как задачу можно взять, иначе он уйдет ниже нуля.
+        // Во время shutdown(Drain) задачи пула еще могут ставить продолжения.
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        if (stopping && currentPool != this) {
+            throw std::runtime_error("ThreadPool is shut down");
+        }
+        pending.fetch_add(1);
+    }
+    try {
+        std::lock_guard<std::mutex> lock(queues[target]->mutex);
+        queues[target]->tasks.push_back({std::move(task), Clock::now()});
+    } catch (...) {
+        pending.fetch_sub(1);
+        throw;
+    }
+    wake.notify_one();
+}
+
+bool ThreadPool::popLocal(size_t self, Item& item) {
+    Worker& worker = *queues[self];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty()) return false;
+    item = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(size_t self, Item& item) {
+    const size_t count = queues.size();
+    for (size_t k = 1; k <= count; ++k) {
+        size_t victim = (self + k) % count;
+        if (victim == self) continue;
+        Worker& worker = *queues[victim];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.tasks.empty()) continue;
+        item = std::move(worker.tasks.front());
+        worker.tasks.pop_front();
+        steals.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::execute(Item& item) {
+    pending.fetch_sub(1);
+
+    uint64_t waited = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - item.queued).count());
+    latencySumNs.fetch_add(waited, std::memory_order_relaxed);
+    uint64_t seenMax = latencyMaxNs.load(std::memory_order_relaxed);
+    while (waited > seenMax && !latencyMaxNs.compare_exchange_weak(seenMax, waited, std::memory_order_relaxed)) {
+    }
+
+    item.task();
+    executed.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool ThreadPool::tryRunOne(size_t self) {
+    Item item;
+    if ((self < queues.size() && popLocal(self, item)) || steal(self, item)) {
+        execute(item);
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    currentPool = this;
+    currentWorker = index;
+
+    for (;;) {
+        if (tryRunOne(index)) continue;
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this] { return stopping || pending > 0; });
+        if (stopping && pending == 0) return;
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+    if (count == 0) return;
+
+    size_t helpers = std::min(count, size()) - 1;
+    if (helpers == 0 || stopping) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    // Состояние общее с помощниками: помощник, запущенный после возврата
+    // из parallelFor, не получит индекса и не тронет fn
+    struct Loop {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> active{0};
+        size_t count = 0;
+        const std::function<void(size_t)>* fn = nullptr;
+        std::mutex mutex;
+        std::condition_variable done;
+
+        void run() {
+            active.fetch_add(1);
+            for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+                (*fn)(i);
+            }
+            if (active.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(mutex);
+                done.notify_all();
+            }
+        }
+    };
+    auto loop = std::make_shared<Loop>();
+    loop->count = count;
+    loop->fn = &fn;
+
+    for (size_t h = 0; h < helpers; ++h) {
+        submit([loop]() { loop->run(); });
+    }
+    loop->run();
+
+    // Ждем только помощников, которые уже взяли индексы; чужие задачи здесь
+    // не выполняются, так как вызывающий может держать блокировки. Поток
+    // спит, а не крутится: на занятых ядрах он отнимал бы время у помощников
+    std::unique_lock<std::mutex> lock(loop->mutex);
+    loop->done.wait(lock, [&loop] { return loop->active.load() == 0; });
+}
+
+void ThreadPool::shutdown(ShutdownMode mode) {
+    if (mode == ShutdownMode::Cancel) {
+        for (auto& worker : queues) {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            cancelled.fetch_add(worker->tasks.size(), std::memory_order_relaxed);
+            pending.fetch_sub(worker->tasks.size());
+            worker->tasks.clear();
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto& thread : threads) {
+        if (thread.joinable() && thread.get_id() != std::this_thread::get_id()) {
+            thread.join();
+        }
+    }
+}
+
+ThreadPool::Stats ThreadPool::getStats() const {
+    Stats stats;
+    stats.workers = queues.size();
+    stats.queueDepth = pending.load();
+    stats.executed = executed.load();
+    stats.steals = steals.load();
+    stats.cancelled = cancelled.load();
+    stats.avgLatencyUs = stats.executed ? latencySumNs.load() / 1000.0 / stats.executed : 0.0;
+    stats.maxLatencyUs = latencyMaxNs.load() / 1000.0;
+    return stats;
+}
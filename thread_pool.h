@@ -0,0 +1,92 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Исполнитель задач с кражей работы: у каждого рабочего своя очередь,
+// владелец берет задачи с конца (LIFO), простаивающие воруют с начала
+// чужих очередей. Без работы потоки спят на условной переменной.
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    enum class ShutdownMode {
+        Drain,   // выполнить все поставленные задачи
+        Cancel   // выбросить невыполненные задачи
+    };
+
+    struct Stats {
+        size_t workers;
+        size_t queueDepth;       // поставлено, но еще не начато
+        uint64_t executed;
+        uint64_t steals;
+        uint64_t cancelled;
+        double avgLatencyUs;     // от submit до начала выполнения
+        double maxLatencyUs;
+    };
+
+    // threads - число рабочих потоков; 0 - все ядра
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const;
+
+    void submit(Task task);
+
+    // Вызывает fn(i) для i в [0, count) и ждет завершения. Вызывающий поток
+    // участвует сам, поэтому вызов безопасен и изнутри задачи пула.
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+    void shutdown(ShutdownMode mode = ShutdownMode::Drain);
+
+    Stats getStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Item {
+        Task task;
+        Clock::time_point queued;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Item> tasks;
+    };
+
+    void workerLoop(size_t index);
+    bool tryRunOne(size_t self);
+    bool popLocal(size_t self, Item& item);
+    bool steal(size_t self, Item& item);
+    void execute(Item& item);
+
+    std::vector<std::unique_ptr<Worker>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<size_t> pending{0};
+    std::atomic<bool> stopping{false};
+    std::atomic<size_t> nextQueue{0};
+
+    std::atomic<uint64_t> executed{0};
+    std::atomic<uint64_t> steals{0};
+    std::atomic<uint64_t> cancelled{0};
+    std::atomic<uint64_t> latencySumNs{0};
+    std::atomic<uint64_t> latencyMaxNs{0};
+};
+
+#endif
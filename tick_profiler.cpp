@@ -0,0 +1,294 @@
+#include "tick_profiler.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+namespace {
+
+std::atomic<uint64_t> nextProfilerId{1};
+
+// Единственный писатель счетчика - его поток: load + store без lock-префикса
+void bump(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+void raise(std::atomic<uint64_t>& counter, uint64_t value) {
+    if (value > counter.load(std::memory_order_relaxed)) {
+        counter.store(value, std::memory_order_relaxed);
+    }
+}
+
+size_t bitWidth(uint64_t value) {
+    size_t width = 0;
+    while (value != 0) {
+        value >>= 1;
+        width++;
+    }
+    return width;
+}
+
+size_t timeBucket(uint64_t ns) {
+    size_t width = bitWidth(ns >> PROFILE_FIRST_BUCKET_SHIFT);
+    return std::min(width, PROFILE_BUCKETS - 1);
+}
+
+// Верхняя граница корзины в секундах (le в Prometheus)
+double bucketBoundSeconds(size_t bucket) {
+    return static_cast<double>(uint64_t(1) << (bucket + PROFILE_FIRST_BUCKET_SHIFT)) / 1e9;
+}
+
+uint64_t killBucketBound(size_t bucket) {
+    return (uint64_t(1) << bucket) - 1;
+}
+
+void writeJson(std::ostream& out, const ProfileSnapshot& s) {
+    auto timers = [&](const char* key, const auto& summaries, auto nameOf) {
+        out << "  \"" << key << "\": {";
+        for (size_t i = 0; i < summaries.size(); ++i) {
+            const TimerSummary& t = summaries[i];
+            out << (i ? "," : "") << "\n    \"" << nameOf(i) << "\": {\"count\": " << t.count
+                << ", \"total_ms\": " << t.totalNs / 1e6 << ", \"mean_us\": " << t.meanUs()
+                << ", \"max_us\": " << t.maxNs / 1e3 << "}";
+        }
+        out << "\n  },\n";
+    };
+    out << std::defaultfloat << std::setprecision(6) << "{\n";
+    timers("phases", s.phases, [](size_t i) { return TickProfiler::phaseName(static_cast<TickPhase>(i)); });
+    timers("lock_wait", s.locks, [](size_t i) { return TickProfiler::lockName(static_cast<ProfiledLock>(i)); });
+    out << "  \"ticks\": " << s.ticks << ",\n  \"kills\": " << s.kills
+        << ",\n  \"kills_last_tick\": " << s.lastTickKills << ",\n  \"kills_max_per_tick\": " << s.maxKillsPerTick
+        << ",\n  \"queue_depth\": " << s.queueDepth << ",\n  \"queue_depth_max\": " << s.maxQueueDepth << "\n}\n";
+}
+
+void writeCsv(std::ostream& out, const ProfileSnapshot& s) {
+    out << std::defaultfloat << std::setprecision(6) << "kind,name,count,total_ms,mean_us,max_us\n";
+    for (size_t i = 0; i < TICK_PHASE_COUNT; ++i) {
+        const TimerSummary& t = s.phases[i];
+        out << "phase," << TickProfiler::phaseName(static_cast<TickPhase>(i)) << "," << t.count << ","
+            << t.totalNs / 1e6 << "," << t.meanUs() << "," << t.maxNs / 1e3 << "\n";
+    }
+    for (size_t i = 0; i < PROFILED_LOCK_COUNT; ++i) {
+        const TimerSummary& t = s.locks[i];
+        out << "lock_wait," << TickProfiler::lockName(static_cast<ProfiledLock>(i)) << "," << t.count << ","
+            << t.totalNs / 1e6 << "," << t.meanUs() << "," << t.maxNs / 1e3 << "\n";
+    }
+    out << "counter,ticks," << s.ticks << ",,,\n"
+        << "counter,kills," << s.kills << ",,,\n"
+        << "gauge,kills_last_tick," << s.lastTickKills << ",,,\n"
+        << "gauge,kills_max_per_tick," << s.maxKillsPerTick << ",,,\n"
+        << "gauge,queue_depth," << s.queueDepth << ",,,\n"
+        << "gauge,queue_depth_max," << s.maxQueueDepth << ",,,\n";
+}
+
+void writePrometheusHistogram(std::ostream& out, const char* metric, const char* label, const char* value,
+                              const TimerSummary& t) {
+    uint64_t cumulative = 0;
+    for (size_t b = 0; b + 1 < PROFILE_BUCKETS; ++b) {
+        cumulative += t.buckets[b];
+        out << metric << "_bucket{" << label << "=\"" << value << "\",le=\"" << bucketBoundSeconds(b)
+            << "\"} " << cumulative << "\n";
+    }
+    out << metric << "_bucket{" << label << "=\"" << value << "\",le=\"+Inf\"} " << t.count << "\n";
+    out << metric << "_sum{" << label << "=\"" << value << "\"} " << t.totalNs / 1e9 << "\n";
+    out << metric << "_count{" << label << "=\"" << value << "\"} " << t.count << "\n";
+}
+
+void writePrometheus(std::ostream& out, const ProfileSnapshot& s) {
+    out << std::defaultfloat << std::setprecision(9);
+    out << "# HELP rpg_tick_phase_seconds Time spent in each simulation phase.\n"
+        << "# TYPE rpg_tick_phase_seconds histogram\n";
+    for (size_t i = 0; i < TICK_PHASE_COUNT; ++i) {
+        writePrometheusHistogram(out, "rpg_tick_phase_seconds", "phase",
+                                 TickProfiler::phaseName(static_cast<TickPhase>(i)), s.phases[i]);
+    }
+    out << "# HELP rpg_lock_wait_seconds Time spent waiting for a mutex.\n"
+        << "# TYPE rpg_lock_wait_seconds histogram\n";
+    for (size_t i = 0; i < PROFILED_LOCK_COUNT; ++i) {
+        writePrometheusHistogram(out, "rpg_lock_wait_seconds", "lock",
+                                 TickProfiler::lockName(static_cast<ProfiledLock>(i)), s.locks[i]);
+    }
+    out << "# HELP rpg_kills_per_tick NPCs killed in one tick.\n"
+        << "# TYPE rpg_kills_per_tick histogram\n";
+    uint64_t cumulative = 0;
+    for (size_t b = 0; b + 1 < KILL_BUCKETS; ++b) {
+        cumulative += s.killBuckets[b];
+        out << "rpg_kills_per_tick_bucket{le=\"" << killBucketBound(b) << "\"} " << cumulative << "\n";
+    }
+    out << "rpg_kills_per_tick_bucket{le=\"+Inf\"} " << s.ticks << "\n"
+        << "rpg_kills_per_tick_sum " << s.kills << "\n"
+        << "rpg_kills_per_tick_count " << s.ticks << "\n";
+    out << "# HELP rpg_ticks_total Completed simulation ticks.\n# TYPE rpg_ticks_total counter\n"
+        << "rpg_ticks_total " << s.ticks << "\n";
+    out << "# HELP rpg_executor_queue_depth Executor tasks submitted but not started, at the end of the last tick.\n"
+        << "# TYPE rpg_executor_queue_depth gauge\n"
+        << "rpg_executor_queue_depth " << s.queueDepth << "\n";
+    out << "# HELP rpg_executor_queue_depth_max Largest executor queue depth seen at the end of a tick.\n"
+        << "# TYPE rpg_executor_queue_depth_max gauge\n"
+        << "rpg_executor_queue_depth_max " << s.maxQueueDepth << "\n";
+}
+
+}
+
+TickProfiler::TickProfiler() : id(nextProfilerId++) {
+}
+
+const char* TickProfiler::phaseName(TickPhase phase) {
+    switch (phase) {
+        case TickPhase::Tick: return "tick";
+        case TickPhase::Compact: return "compact";
+        case TickPhase::Move: return "move";
+        case TickPhase::GridRebuild: return "grid_rebuild";
+        case TickPhase::MoveEvents: return "move_events";
+        case TickPhase::Combat: return "combat";
+        case TickPhase::KillEvents: return "kill_events";
+        case TickPhase::PublishFrame: return "publish_frame";
+        case TickPhase::Render: return "render";
+        case TickPhase::ReportEvents: return "report_events";
+        case TickPhase::Count: break;
+    }
+    return "unknown";
+}
+
+const char* TickProfiler::lockName(ProfiledLock lock) {
+    switch (lock) {
+        case ProfiledLock::Cout: return "cout";
+        case ProfiledLock::Count: break;
+    }
+    return "unknown";
+}
+
+TickProfiler::Slot& TickProfiler::localSlot() {
+    // Поток обычно пишет в один профилировщик: его слот запоминается без поиска
+    thread_local uint64_t cachedProfiler = 0;
+    thread_local Slot* cachedSlot = nullptr;
+    if (cachedProfiler == id) return *cachedSlot;
+
+    std::lock_guard<std::mutex> lock(slotsMutex);
+    const std::thread::id self = std::this_thread::get_id();
+    auto it = std::find_if(slots.begin(), slots.end(), [&](const auto& entry) { return entry.first == self; });
+    if (it == slots.end()) {
+        slots.emplace_back(self, std::make_unique<Slot>());
+        it = slots.end() - 1;
+    }
+    cachedProfiler = id;
+    cachedSlot = it->second.get();
+    return *cachedSlot;
+}
+
+void TickProfiler::addTime(TimerCounters& timer, uint64_t ns) {
+    bump(timer.count, 1);
+    bump(timer.totalNs, ns);
+    raise(timer.maxNs, ns);
+    bump(timer.buckets[timeBucket(ns)], 1);
+}
+
+void TickProfiler::recordPhase(TickPhase phase, uint64_t ns) {
+    addTime(localSlot().phases[static_cast<size_t>(phase)], ns);
+}
+
+void TickProfiler::recordLockWait(ProfiledLock lock, uint64_t ns) {
+    addTime(localSlot().locks[static_cast<size_t>(lock)], ns);
+}
+
+void TickProfiler::recordTick(uint32_t tick, uint32_t kills, size_t queueDepth) {
+    Slot& slot = localSlot();
+    bump(slot.ticks, 1);
+    bump(slot.kills, kills);
+    raise(slot.maxKills, kills);
+    bump(slot.killBuckets[std::min(bitWidth(kills), KILL_BUCKETS - 1)], 1);
+    raise(slot.maxQueueDepth, queueDepth);
+    slot.lastKills.store(kills, std::memory_order_relaxed);
+    slot.lastQueueDepth.store(queueDepth, std::memory_order_relaxed);
+    slot.lastTick.store(static_cast<uint64_t>(tick) + 1, std::memory_order_relaxed);
+}
+
+std::unique_lock<std::mutex> TickProfiler::lock(std::mutex& mutex, ProfiledLock id) {
+    std::unique_lock<std::mutex> guard(mutex, std::try_to_lock);
+    if (guard.owns_lock()) {
+        recordLockWait(id, 0);
+        return guard;
+    }
+    auto start = std::chrono::steady_clock::now();
+    guard.lock();
+    recordLockWait(id, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count()));
+    return guard;
+}
+
+void TickProfiler::collect(TimerSummary& into, const TimerCounters& from) {
+    into.count += from.count.load(std::memory_order_relaxed);
+    into.totalNs += from.totalNs.load(std::memory_order_relaxed);
+    into.maxNs = std::max(into.maxNs, from.maxNs.load(std::memory_order_relaxed));
+    for (size_t b = 0; b < PROFILE_BUCKETS; ++b) {
+        into.buckets[b] += from.buckets[b].load(std::memory_order_relaxed);
+    }
+}
+
+ProfileSnapshot TickProfiler::snapshot() const {
+    ProfileSnapshot s;
+    uint64_t lastTick = 0;
+    std::lock_guard<std::mutex> lock(slotsMutex);
+    for (const auto& entry : slots) {
+        const Slot& slot = *entry.second;
+        for (size_t p = 0; p < TICK_PHASE_COUNT; ++p) {
+            collect(s.phases[p], slot.phases[p]);
+        }
+        for (size_t l = 0; l < PROFILED_LOCK_COUNT; ++l) {
+            collect(s.locks[l], slot.locks[l]);
+        }
+        s.ticks += slot.ticks.load(std::memory_order_relaxed);
+        s.kills += slot.kills.load(std::memory_order_relaxed);
+        s.maxKillsPerTick = std::max(s.maxKillsPerTick, slot.maxKills.load(std::memory_order_relaxed));
+        s.maxQueueDepth = std::max(s.maxQueueDepth, slot.maxQueueDepth.load(std::memory_order_relaxed));
+        for (size_t b = 0; b < KILL_BUCKETS; ++b) {
+            s.killBuckets[b] += slot.killBuckets[b].load(std::memory_order_relaxed);
+        }
+        uint64_t tick = slot.lastTick.load(std::memory_order_relaxed);
+        if (tick > lastTick) {
+            lastTick = tick;
+            s.lastTickKills = slot.lastKills.load(std::memory_order_relaxed);
+            s.queueDepth = slot.lastQueueDepth.load(std::memory_order_relaxed);
+        }
+    }
+    return s;
+}
+
+MetricsFormat metricsFormatFor(const std::string& path) {
+    auto endsWith = [&](const char* suffix) {
+        std::string s(suffix);
+        return path.size() >= s.size() && path.compare(path.size() - s.size(), s.size(), s) == 0;
+    };
+    if (endsWith(".json")) return MetricsFormat::Json;
+    if (endsWith(".csv")) return MetricsFormat::Csv;
+    return MetricsFormat::Prometheus;
+}
+
+void writeMetrics(std::ostream& out, const ProfileSnapshot& snapshot, MetricsFormat format) {
+    switch (format) {
+        case MetricsFormat::Json: writeJson(out, snapshot); break;
+        case MetricsFormat::Csv: writeCsv(out, snapshot); break;
+        case MetricsFormat::Prometheus: writePrometheus(out, snapshot); break;
+    }
+}
+
+void writeMetricsFile(const std::string& path, const ProfileSnapshot& snapshot, MetricsFormat format) {
+    const std::string temp = path + ".tmp";
+    {
+        std::ofstream file(temp, std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error("Cannot write metrics file: " + temp);
+        }
+        writeMetrics(file, snapshot, format);
+        if (!file) {
+            throw std::runtime_error("Failed to write metrics file: " + temp);
+        }
+    }
+#ifdef _WIN32
+    std::remove(path.c_str());  // rename в Windows не заменяет существующий файл
+#endif
+    if (std::rename(temp.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Cannot replace metrics file: " + path);
+    }
+}
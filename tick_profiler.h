@@ -0,0 +1,178 @@
+#ifndef TICK_PROFILER_H
+#define TICK_PROFILER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Профилировщик тика движка: время фаз, ожидание блокировок, убийства за тик
+// и глубина очереди исполнителя. Каждый поток пишет в свой набор счетчиков
+// (только он их меняет - обычные load/store, без атомарных RMW и без
+// блокировок); snapshot складывает потоки.
+//
+// В код движка профилировщик встроен макросами RPG_PROFILE_*. Без
+// RPG_PROFILING (cmake -DRPG_PROFILING=ON) они пустые: замеров, чтения
+// часов и статистики исполнителя в сборке нет.
+
+enum class TickPhase {
+    Tick,          // весь simulationTick
+    Compact,
+    Move,
+    GridRebuild,
+    MoveEvents,
+    Combat,        // TiledCombat::resolve
+    KillEvents,    // снятие убитых с сетки и запись событий
+    PublishFrame,
+    Render,        // сборка кадра карты, без вывода
+    ReportEvents,  // доставка событий наблюдателям
+    Count
+};
+
+enum class ProfiledLock {
+    Cout,  // GameEngine::coutMutex
+    Count
+};
+
+constexpr size_t TICK_PHASE_COUNT = static_cast<size_t>(TickPhase::Count);
+constexpr size_t PROFILED_LOCK_COUNT = static_cast<size_t>(ProfiledLock::Count);
+
+// Корзины гистограммы по степеням двойки: корзина i - меньше 2^(i+8) нс
+// (256 нс ... ~2 с), последняя - все, что больше
+constexpr size_t PROFILE_BUCKETS = 24;
+constexpr int PROFILE_FIRST_BUCKET_SHIFT = 8;
+// Убийства за тик: корзина i - не больше 2^i - 1 (0, 1, 3, 7, ...)
+constexpr size_t KILL_BUCKETS = 16;
+
+struct TimerSummary {
+    uint64_t count = 0;
+    uint64_t totalNs = 0;
+    uint64_t maxNs = 0;
+    std::array<uint64_t, PROFILE_BUCKETS> buckets{};
+
+    double meanUs() const { return count ? totalNs / 1000.0 / count : 0.0; }
+};
+
+struct ProfileSnapshot {
+    std::array<TimerSummary, TICK_PHASE_COUNT> phases;
+    std::array<TimerSummary, PROFILED_LOCK_COUNT> locks;
+    uint64_t ticks = 0;
+    uint64_t kills = 0;
+    uint64_t maxKillsPerTick = 0;
+    uint64_t lastTickKills = 0;
+    std::array<uint64_t, KILL_BUCKETS> killBuckets{};
+    uint64_t queueDepth = 0;     // на конце последнего тика
+    uint64_t maxQueueDepth = 0;
+};
+
+enum class MetricsFormat {
+    Json,
+    Csv,
+    Prometheus  // текстовый формат экспозиции, для node_exporter textfile
+};
+
+class TickProfiler {
+public:
+#ifdef RPG_PROFILING
+    static constexpr bool enabled = true;
+#else
+    static constexpr bool enabled = false;
+#endif
+
+    TickProfiler();
+
+    static const char* phaseName(TickPhase phase);
+    static const char* lockName(ProfiledLock lock);
+
+    void recordPhase(TickPhase phase, uint64_t ns);
+    void recordLockWait(ProfiledLock lock, uint64_t ns);
+    // tick - номер тика движка; последний тик берется по наибольшему номеру
+    void recordTick(uint32_t tick, uint32_t kills, size_t queueDepth);
+
+    // Свободная блокировка берется без чтения часов и считается с нулевым ожиданием
+    std::unique_lock<std::mutex> lock(std::mutex& mutex, ProfiledLock id);
+
+    // Сумма по всем потокам; можно вызывать во время записи
+    ProfileSnapshot snapshot() const;
+
+    // Время фазы от создания до разрушения
+    class Scope {
+    public:
+        Scope(TickProfiler& profiler, TickPhase phase)
+            : profiler(profiler), phase(phase), start(std::chrono::steady_clock::now()) {}
+        ~Scope() {
+            profiler.recordPhase(phase, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count()));
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        TickProfiler& profiler;
+        TickPhase phase;
+        std::chrono::steady_clock::time_point start;
+    };
+
+private:
+    using Counter = std::atomic<uint64_t>;
+
+    struct TimerCounters {
+        Counter count{0};
+        Counter totalNs{0};
+        Counter maxNs{0};
+        std::array<Counter, PROFILE_BUCKETS> buckets{};
+    };
+
+    // Счетчики одного потока
+    struct Slot {
+        std::array<TimerCounters, TICK_PHASE_COUNT> phases;
+        std::array<TimerCounters, PROFILED_LOCK_COUNT> locks;
+        Counter ticks{0};
+        Counter kills{0};
+        Counter maxKills{0};
+        std::array<Counter, KILL_BUCKETS> killBuckets{};
+        Counter maxQueueDepth{0};
+        Counter lastTick{0};  // номер тика + 1, 0 - тиков не было
+        Counter lastKills{0};
+        Counter lastQueueDepth{0};
+    };
+
+    Slot& localSlot();
+    static void addTime(TimerCounters& timer, uint64_t ns);
+    static void collect(TimerSummary& into, const TimerCounters& from);
+
+    const uint64_t id;  // отличает профилировщики в кэше слота потока
+    mutable std::mutex slotsMutex;
+    std::vector<std::pair<std::thread::id, std::unique_ptr<Slot>>> slots;
+};
+
+// Формат по расширению: .json, .csv, иначе Prometheus
+MetricsFormat metricsFormatFor(const std::string& path);
+void writeMetrics(std::ostream& out, const ProfileSnapshot& snapshot, MetricsFormat format);
+// Через временный файл и rename: читатель не увидит файл наполовину записанным
+void writeMetricsFile(const std::string& path, const ProfileSnapshot& snapshot, MetricsFormat format);
+
+#ifdef RPG_PROFILING
+#define RPG_PROFILE_CONCAT_INNER(a, b) a##b
+#define RPG_PROFILE_CONCAT(a, b) RPG_PROFILE_CONCAT_INNER(a, b)
+#define RPG_PROFILE_PHASE(profiler, phase) \
+    TickProfiler::Scope RPG_PROFILE_CONCAT(profileScope, __LINE__)((profiler), (phase))
+#define RPG_PROFILE_TICK(profiler, tick, kills, queueDepth) \
+    (profiler).recordTick((tick), (kills), (queueDepth))
+#define RPG_PROFILED_LOCK(name, target, profiler, lockId) \
+    std::unique_lock<std::mutex> name = (profiler).lock((target), (lockId))
+#else
+#define RPG_PROFILE_PHASE(profiler, phase) ((void)0)
+#define RPG_PROFILE_TICK(profiler, tick, kills, queueDepth) ((void)0)
+#define RPG_PROFILED_LOCK(name, target, profiler, lockId) std::lock_guard<std::mutex> name(target)
+#endif
+
+#endif
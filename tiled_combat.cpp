@@ -0,0 +1,116 @@
+#include "tiled_combat.h"
+#include "simd_kernels.h"
+#include "kill_matrix.h"
+#include <algorithm>
+
+namespace {
+
+// Бросок атаки против броска защиты (как NPC::tryKill) из 16-битных половин хэша
+bool diceWin(uint32_t h) {
+    int attack = 1 + static_cast<int>(((h & 0xFFFFu) * 6u) >> 16);
+    int defense = 1 + static_cast<int>(((h >> 16) * 6u) >> 16);
+    return attack > defense;
+}
+
+}
+
+TiledCombat::TiledCombat(int range)
+    : range(std::max(range, 0)),
+      tileChunks(std::max((2 * std::max(range, 0) + SparseGrid::CHUNK_SIZE - 1) / SparseGrid::CHUNK_SIZE, 1)) {
+}
+
+void TiledCombat::resolveTile(const NPCWorld& world, const SparseGrid& grid, Tile tile,
+                              std::vector<KillRecord>& kills, uint8_t* dead, uint32_t tickKey) const {
+    kills.clear();
+    auto alive = [&](NPCHandle h) { return !dead[h] && world.isAlive(h); };
+    for (int cy = tile.y * tileChunks; cy < (tile.y + 1) * tileChunks; ++cy) {
+        for (int cx = tile.x * tileChunks; cx < (tile.x + 1) * tileChunks; ++cx) {
+            grid.forEachInChunk(cx, cy, [&](NPCHandle a, int ax, int ay) {
+                // Все соседи в квадрате range лежат в полосе этой плитки,
+                // которую в этой фазе не трогает никакая другая плитка
+                grid.forEachInSquare(ax, ay, range, [&](NPCHandle b) {
+                    if (b <= a || !alive(a) || !alive(b)) return;
+
+                    const uint8_t outcome = fightOutcome(world.getType(a), world.getType(b));
+                    if (outcome == FIGHT_NONE) return;
+                    bool aCanKill = outcome & FIGHT_A_KILLS;
+                    bool bCanKill = outcome & FIGHT_B_KILLS;
+
+                    uint32_t pairKey = streamHash(tickKey, a * 0x9e3779b1u + b);
+                    bool aKills = aCanKill && diceWin(pairKey);
+                    bool bKills = bCanKill && diceWin(streamHash(pairKey, b));
+
+                    if (aKills && bKills) {
+                        kills.push_back({a, b, true});
+                        dead[a] = 1;
+                        dead[b] = 1;
+                    } else if (aKills) {
+                        kills.push_back({a, b, false});
+                        dead[b] = 1;
+                    } else if (bKills) {
+                        kills.push_back({b, a, false});
+                        dead[a] = 1;
+                    }
+                });
+            });
+        }
+    }
+}
+
+std::vector<KillRecord> TiledCombat::resolve(NPCWorld& world, const SparseGrid& grid, ThreadPool& pool,
+                                             uint32_t key, uint32_t tick) {
+    const uint32_t tickKey = streamHash(key, tick);
+
+    // Плитки с непустыми чанками по фазам шахматной раскраски 2x2. Порядок
+    // чанков задан перестройкой сетки, поэтому порядок убийств не зависит от потоков
+    for (auto& tiles : phaseTiles) tiles.clear();
+    auto floorDiv = [](int a, int b) { return a >= 0 ? a / b : -((-a + b - 1) / b); };
+    grid.forEachChunk([&](int cx, int cy) {
+        Tile tile{floorDiv(cx, tileChunks), floorDiv(cy, tileChunks)};
+        auto& tiles = phaseTiles[(tile.x & 1) + 2 * (tile.y & 1)];
+        // Соседние чанки строки обычно в той же плитке
+        if (tiles.empty() || tiles.back().x != tile.x || tiles.back().y != tile.y) {
+            tiles.push_back(tile);
+        }
+    });
+
+    if (dying.size() < world.handleCount()) {
+        dying.resize(world.handleCount(), 0);
+    }
+
+    std::vector<KillRecord> result;
+    for (auto& tiles : phaseTiles) {
+        // Плитка из нескольких чанков встречается несколько раз
+        if (tileChunks > 1) {
+            std::sort(tiles.begin(), tiles.end(), [](const Tile& a, const Tile& b) {
+                return a.y != b.y ? a.y < b.y : a.x < b.x;
+            });
+            tiles.erase(std::unique(tiles.begin(), tiles.end(), [](const Tile& a, const Tile& b) {
+                return a.x == b.x && a.y == b.y;
+            }), tiles.end());
+        }
+        if (tileKills.size() < tiles.size()) {
+            tileKills.resize(tiles.size());
+        }
+
+        pool.parallelFor(tiles.size(), [&](size_t k) {
+            resolveTile(world, grid, tiles[k], tileKills[k], dying.data(), tickKey);
+        });
+        for (size_t k = 0; k < tiles.size(); ++k) {
+            for (const KillRecord& kill : tileKills[k]) {
+                world.markDead(kill.victim);
+                dying[kill.victim] = 0;
+                if (kill.mutual) {
+                    world.markDead(kill.killer);
+                    dying[kill.killer] = 0;
+                }
+            }
+            result.insert(result.end(), tileKills[k].begin(), tileKills[k].end());
+        }
+    }
+    return result;
+}
+
+int TiledCombat::getTileSize() const {
+    return tileChunks * SparseGrid::CHUNK_SIZE;
+}
@@ -0,0 +1,56 @@
+#ifndef TILED_COMBAT_H
+#define TILED_COMBAT_H
+
+#include "npc_world.h"
+#include "sparse_grid.h"
+#include "thread_pool.h"
+#include <cstdint>
+#include <vector>
+
+// Убийство за раунд боя; mutual - оба NPC убили друг друга
+struct KillRecord {
+    NPCHandle killer;
+    NPCHandle victim;
+    bool mutual;
+};
+
+// Параллельный бой по плиткам карты. Плитка - квадрат из целых чанков
+// SparseGrid со стороной не меньше 2*range, поэтому плитки одного цвета
+// шахматной раскраски 2x2 вместе с полосой range вокруг себя не
+// пересекаются и решаются без блокировок. Обходятся только плитки с
+// непустыми чанками: пустая часть карты не стоит ничего.
+// Пара (a, b), a < b, в квадрате range принадлежит плитке NPC a и
+// проверяется один раз. Результат зависит только от ключа и номера тика,
+// но не от числа потоков.
+//
+// Флаги жизни мира упакованы по 64 в слово, и слово делят NPC разных плиток,
+// поэтому во время фазы мир только читается: убитые отмечаются байтом по
+// хэндлу (у каждого NPC свой), а снимаются с мира после фазы в вызывающем потоке.
+class TiledCombat {
+public:
+    explicit TiledCombat(int range);
+
+    // Сетка должна содержать живых NPC мира на их текущих позициях
+    std::vector<KillRecord> resolve(NPCWorld& world, const SparseGrid& grid, ThreadPool& pool,
+                                    uint32_t key, uint32_t tick);
+
+    int getTileSize() const;
+
+private:
+    struct Tile {
+        int x;
+        int y;
+    };
+
+    int range;
+    int tileChunks;  // сторона плитки в чанках
+
+    std::vector<Tile> phaseTiles[4];
+    std::vector<std::vector<KillRecord>> tileKills;
+    std::vector<uint8_t> dying;  // по хэндлу: убит в текущей фазе, после фазы 0
+
+    void resolveTile(const NPCWorld& world, const SparseGrid& grid, Tile tile,
+                     std::vector<KillRecord>& kills, uint8_t* dead, uint32_t tickKey) const;
+};
+
+#endif
@@ -1,30 +1,24 @@
 #include "visitor.h"
 #include "game_constants.h"
-#include <cmath>
+#include "spatial_grid.h"
+#include "simd_kernels.h"
 #include <iostream>
 
 NPCVisitor::NPCVisitor(int range, Observable& observable)
     : range(range), observable(observable) {
 }
 
-bool NPCVisitor::inRange(const NPC& a, const NPC& b) const {
-    int dx = a.getX() - b.getX();
-    int dy = a.getY() - b.getY();
-    double distance = std::sqrt(dx*dx + dy*dy);
-    return distance <= range;
+NPCVisitor::NPCVisitor(const WorldConfig& config, Observable& observable)
+    : NPCVisitor(config.killDistance, observable) {
 }
 
-bool NPCVisitor::canKill(NPCType killer, NPCType victim) const {
-    // Оборотни убивают Разбойников
-    if (killer == NPCType::Werewolf && victim == NPCType::Rogue) return true;
-    // Разбойники убивают медведей
-    if (killer == NPCType::Rogue && victim == NPCType::Bear) return true;
-    // Медведи убивают оборотней
-    if (killer == NPCType::Bear && victim == NPCType::Werewolf) return true;
-    return false;
+bool NPCVisitor::inRange(const NPC& a, const NPC& b) const {
+    // Сравниваем квадраты расстояний, без sqrt
+    int64_t dx = static_cast<int64_t>(a.getX()) - b.getX();
+    int64_t dy = static_cast<int64_t>(a.getY()) - b.getY();
+    return range >= 0 && dx*dx + dy*dy <= static_cast<int64_t>(range) * range;
 }
 
-
 void NPCVisitor::visit(Bear& bear) {
     // Реализация если нужна
     (void)bear;  // Чтобы убрать warning
@@ -40,30 +34,87 @@ void NPCVisitor::visit(Rogue& rogue) {
     (void)rogue;  // Чтобы убрать warning
 }
 
+void NPCVisitor::resolve(std::vector<std::shared_ptr<NPC>>& npcs, size_t i, size_t j) {
+    NPC& a = *npcs[i];
+    NPC& b = *npcs[j];
+    const uint8_t outcome = fightOutcome(a.getType(), b.getType());
+    if (outcome == FIGHT_NONE) return;
+    
+    // Индексы и NameId вместо строк; имена нужны только наблюдателям
+    const uint32_t ia = static_cast<uint32_t>(i);
+    const uint32_t ib = static_cast<uint32_t>(j);
+    bool aKillsB = outcome & FIGHT_A_KILLS;
+    bool bKillsA = outcome & FIGHT_B_KILLS;
+    if (aKillsB && bKillsA) {
+        observable.record({0, ia, ib, a.getNameId(), b.getNameId(), true});
+        a.markDead();
+        b.markDead();
+    } else if (aKillsB) {
+        observable.record({0, ia, ib, a.getNameId(), b.getNameId(), false});
+        b.markDead();
+    } else if (bKillsA) {
+        observable.record({0, ib, ia, b.getNameId(), a.getNameId(), false});
+        a.markDead();
+    }
+}
+
 void NPCVisitor::fight(std::vector<std::shared_ptr<NPC>>& npcs) {
+    if (range < 0) return;
+    
+    // На маленьких подземельях построение сетки дороже перебора
+    if (npcs.size() < GRID_FIGHT_THRESHOLD) {
+        fightBruteForce(npcs);
+    } else {
+        fightSpatial(npcs);
+    }
+}
+
+void NPCVisitor::fightSpatial(std::vector<std::shared_ptr<NPC>>& npcs) {
+    if (range < 0) return;
+    
+    SpatialGrid grid(npcs, range);
+    std::vector<uint32_t> candidates;
+    
+    // Тот же порядок, что и у перебора i<j: кандидаты j отсортированы
     for (size_t i = 0; i < npcs.size(); ++i) {
         if (!npcs[i]->isAlive()) continue;
         
-        for (size_t j = i + 1; j < npcs.size(); ++j) {
+        grid.collectCandidates(i, candidates);
+        for (uint32_t j : candidates) {
             if (!npcs[j]->isAlive()) continue;
             
             if (inRange(*npcs[i], *npcs[j])) {
-                bool iKillsJ = canKill(npcs[i]->getType(), npcs[j]->getType());
-                bool jKillsI = canKill(npcs[j]->getType(), npcs[i]->getType());
-                
-                if (iKillsJ && jKillsI) {
-                    observable.notifyKill(npcs[i]->getName(), npcs[j]->getName());
-                    observable.notifyKill(npcs[j]->getName(), npcs[i]->getName());
-                    npcs[i]->markDead();
-                    npcs[j]->markDead();
-                } else if (iKillsJ) {
-                    observable.notifyKill(npcs[i]->getName(), npcs[j]->getName());
-                    npcs[j]->markDead();
-                } else if (jKillsI) {
-                    observable.notifyKill(npcs[j]->getName(), npcs[i]->getName());
-                    npcs[i]->markDead();
-                }
+                resolve(npcs, i, j);
             }
         }
     }
-}
\ No newline at end of file
+    observable.flush();
+}
+
+void NPCVisitor::fightBruteForce(std::vector<std::shared_ptr<NPC>>& npcs) {
+    if (range < 0) return;
+    
+    // Координаты в непрерывных массивах, чтобы проверять расстояния пакетно
+    const size_t count = npcs.size();
+    std::vector<int32_t> xs(count), ys(count);
+    for (size_t i = 0; i < count; ++i) {
+        xs[i] = npcs[i]->getX();
+        ys[i] = npcs[i]->getY();
+    }
+    std::vector<uint8_t> near(count);
+    const int64_t range2 = static_cast<int64_t>(range) * range;
+    
+    for (size_t i = 0; i < count; ++i) {
+        if (!npcs[i]->isAlive()) continue;
+        
+        size_t first = i + 1;
+        inRangeMask(xs.data() + first, ys.data() + first, count - first,
+                    xs[i], ys[i], range2, near.data() + first);
+        for (size_t j = first; j < count; ++j) {
+            if (!near[j] || !npcs[j]->isAlive()) continue;
+            
+            resolve(npcs, i, j);
+        }
+    }
+    observable.flush();
+}
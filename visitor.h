@@ -3,6 +3,8 @@
 
 #include "observer.h"
 #include "npc.h"
+#include "kill_matrix.h"
+#include "world_config.h"
 #include <memory>
 #include <vector>
 
@@ -14,20 +16,29 @@ class Rogue;
 class NPCVisitor {
 public:
     NPCVisitor(int range, Observable& observable);
+    // Дальность боя - config.killDistance
+    NPCVisitor(const WorldConfig& config, Observable& observable);
 
     void visit(Bear& bear);
     void visit(Werewolf& werewolf);  // Изменено
     void visit(Rogue& rogue);
     
+    // Убийства пишутся в шину observable и доставляются одной пачкой в конце боя
     void fight(std::vector<std::shared_ptr<NPC>>& npcs);
+    void fightBruteForce(std::vector<std::shared_ptr<NPC>>& npcs);  // Полный перебор O(n^2)
+    void fightSpatial(std::vector<std::shared_ptr<NPC>>& npcs);     // Через SpatialGrid
     
-    bool canKill(NPCType killer, NPCType victim) const;  // Сделайте public
+    // Табличный поиск по KILL_RULES (kill_matrix.h)
+    static constexpr bool canKill(NPCType killer, NPCType victim) {
+        return ::canKill(killer, victim);
+    }
 
 private:
     int range;
     Observable& observable;
     
     bool inRange(const NPC& a, const NPC& b) const;
+    void resolve(std::vector<std::shared_ptr<NPC>>& npcs, size_t i, size_t j);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "world_config.h"
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+
+// Сторона карты ограничена, чтобы y * width + x и сумма координат с шагом
+// оставались в int64 и int32 без переполнения
+constexpr int MAX_MAP_SIDE = 1 << 20;
+// randomSteps берет шаг из 16 бит хэша: 2 * distance + 1 должно влезать в 16 бит
+constexpr int MAX_MOVE_DISTANCE = 32767;
+
+std::string_view trim(std::string_view text) {
+    size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string_view::npos) return {};
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+template <typename T>
+T parseNumber(const std::string& key, std::string_view text) {
+    T value{};
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc() || ptr != text.data() + text.size()) {
+        throw std::runtime_error("Invalid value for " + key + ": '" + std::string(text) + "'");
+    }
+    return value;
+}
+
+// from_chars для double есть не во всех стандартных библиотеках C++17
+double parseDouble(const std::string& key, const std::string& text) {
+    size_t used = 0;
+    double value = 0.0;
+    try {
+        value = std::stod(text, &used);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (used == 0 || used != text.size()) {
+        throw std::runtime_error("Invalid value for " + key + ": '" + text + "'");
+    }
+    return value;
+}
+
+void requireRange(const char* key, long long value, long long min, long long max) {
+    if (value < min || value > max) {
+        throw std::runtime_error(std::string(key) + " must be in [" + std::to_string(min) + ", " +
+                                 std::to_string(max) + "], got " + std::to_string(value));
+    }
+}
+
+}
+
+WorldConfig WorldConfig::editorDefaults() {
+    WorldConfig config;
+    config.mapWidth = EDITOR_MAP_SIZE;
+    config.mapHeight = EDITOR_MAP_SIZE;
+    return config;
+}
+
+WorldConfig WorldConfig::fromFile(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file) {
+        throw std::runtime_error("Cannot open config file: " + filename);
+    }
+
+    WorldConfig config;
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        std::string_view text = line;
+        text = trim(text.substr(0, text.find('#')));
+        if (text.empty()) continue;
+
+        size_t eq = text.find('=');
+        if (eq == std::string_view::npos) {
+            throw std::runtime_error(filename + ":" + std::to_string(lineNumber) + ": expected key = value");
+        }
+        try {
+            config.set(std::string(trim(text.substr(0, eq))), std::string(trim(text.substr(eq + 1))));
+        } catch (const std::runtime_error& e) {
+            throw std::runtime_error(filename + ":" + std::to_string(lineNumber) + ": " + e.what());
+        }
+    }
+    config.validate();
+    return config;
+}
+
+void WorldConfig::set(const std::string& key, const std::string& value) {
+    if (key == "map_width") {
+        mapWidth = parseNumber<int>(key, value);
+    } else if (key == "map_height") {
+        mapHeight = parseNumber<int>(key, value);
+    } else if (key == "npc_count") {
+        npcCount = parseNumber<int>(key, value);
+    } else if (key == "kill_distance") {
+        killDistance = parseNumber<int>(key, value);
+    } else if (key == "move_distance") {
+        moveDistance = parseNumber<int>(key, value);
+    } else if (key == "duration_seconds") {
+        durationSeconds = parseNumber<int>(key, value);
+    } else if (key == "tick_rate") {
+        tickRate = parseDouble(key, value);
+    } else if (key == "worker_threads") {
+        workerThreads = parseNumber<size_t>(key, value);
+    } else {
+        throw std::runtime_error("Unknown config key: " + key);
+    }
+}
+
+void WorldConfig::validate() const {
+    requireRange("map_width", mapWidth, 1, MAX_MAP_SIDE);
+    requireRange("map_height", mapHeight, 1, MAX_MAP_SIDE);
+    requireRange("npc_count", npcCount, 0, INT32_MAX);
+    requireRange("kill_distance", killDistance, 0, MAX_MAP_SIDE);
+    requireRange("move_distance", moveDistance, 0, MAX_MOVE_DISTANCE);
+    requireRange("duration_seconds", durationSeconds, 1, INT32_MAX);
+    if (!std::isfinite(tickRate) || !(tickRate > 0) || tickRate > MAX_TICK_RATE_HZ) {
+        throw std::runtime_error("tick_rate must be in (0, " + std::to_string(static_cast<int>(MAX_TICK_RATE_HZ)) + "], got " +
+                                 std::to_string(tickRate));
+    }
+    if (workerThreads > MAX_WORKER_THREADS) {
+        throw std::runtime_error("worker_threads must be in [0, " + std::to_string(MAX_WORKER_THREADS) + "], got " +
+                                 std::to_string(workerThreads));
+    }
+}
+
+bool WorldConfig::contains(int x, int y) const {
+    return x >= 0 && x < mapWidth && y >= 0 && y < mapHeight;
+}
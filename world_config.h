@@ -0,0 +1,35 @@
+#ifndef WORLD_CONFIG_H
+#define WORLD_CONFIG_H
+
+#include "game_constants.h"
+#include <cstddef>
+#include <string>
+
+// Параметры мира, задаваемые при запуске. Значения по умолчанию - константы
+// из game_constants.h; движок, редактор и бой берут размеры карты и дальности
+// только отсюда, поэтому подземелье из редактора не обрезается в движке.
+struct WorldConfig {
+    int mapWidth = MAP_WIDTH;
+    int mapHeight = MAP_HEIGHT;
+    int npcCount = INITIAL_NPC_COUNT;
+    int killDistance = KILL_DISTANCE;
+    int moveDistance = MOVE_DISTANCE;
+    int durationSeconds = GAME_DURATION_SECONDS;
+    double tickRate = TICK_RATE_HZ;
+    size_t workerThreads = WORKER_THREAD_COUNT;
+
+    // Конфигурация редактора по умолчанию: прежние границы 0-500
+    static WorldConfig editorDefaults();
+
+    // Файл "ключ = значение", ключи как у set; '#' - комментарий до конца строки
+    static WorldConfig fromFile(const std::string& filename);
+    // Один параметр по имени: map_width, map_height, npc_count, kill_distance,
+    // move_distance, duration_seconds, tick_rate, worker_threads
+    void set(const std::string& key, const std::string& value);
+
+    // runtime_error с именем параметра, если значение вне допустимых пределов
+    void validate() const;
+    bool contains(int x, int y) const;
+};
+
+#endif
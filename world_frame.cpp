@@ -0,0 +1,84 @@
+#include "world_frame.h"
+#include "factory.h"
+
+void WorldFrame::capture(const NPCWorld& world, uint32_t completedTicks) {
+    tick = completedTicks;
+
+    // resize не освобождает память: переиспользованный кадр не выделяет ничего
+    size_t count = world.aliveCount();
+    handles.resize(count);
+    x.resize(count);
+    y.resize(count);
+    type.resize(count);
+    names.resize(count);
+
+    // Проход по словам флагов жизни, как в forEachAlive, но с записью по индексу
+    const int32_t* wx = world.xData();
+    const int32_t* wy = world.yData();
+    const NPCType* wt = world.typeData();
+    const uint64_t* bits = world.aliveBits();
+    size_t words = (world.size() + 63) / 64;
+    size_t i = 0;
+    for (size_t w = 0; w < words; ++w) {
+        for (uint64_t word = bits[w]; word != 0; word &= word - 1) {
+            uint32_t slot = static_cast<uint32_t>(w * 64 + countTrailingZeros(word));
+            NPCHandle h = world.handleAt(slot);
+            handles[i] = h;
+            x[i] = wx[slot];
+            y[i] = wy[slot];
+            type[i] = wt[slot];
+            names[i] = world.getNameId(h);
+            ++i;
+        }
+    }
+}
+
+std::shared_ptr<NPC> WorldFrame::toNPC(size_t i) const {
+    return NPCFactory::create(type[i], x[i], y[i], names[i]);
+}
+
+std::vector<std::shared_ptr<NPC>> WorldFrame::toNPCs() const {
+    std::vector<std::shared_ptr<NPC>> result;
+    result.reserve(size());
+    for (size_t i = 0; i < size(); ++i) {
+        result.push_back(toNPC(i));
+    }
+    return result;
+}
+
+FramePublisher::FramePublisher()
+    : front(std::make_shared<WorldFrame>()), back(std::make_shared<WorldFrame>()) {
+    std::atomic_store(&published, std::shared_ptr<const WorldFrame>(front));
+}
+
+WorldFrame& FramePublisher::acquire() {
+    // Единственная ссылка у писателя - читателей у кадра нет, и новых не будет:
+    // задний кадр не опубликован. Барьер упорядочивает наши записи после
+    // чтений тех, кто отпустил кадр.
+    if (back.use_count() == 1) {
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } else {
+        back = std::make_shared<WorldFrame>();
+        fresh.fetch_add(1, std::memory_order_relaxed);
+    }
+    return *back;
+}
+
+void FramePublisher::publish() {
+    back->epoch = epochs.load(std::memory_order_relaxed) + 1;
+    std::swap(front, back);
+    std::atomic_store(&published, std::shared_ptr<const WorldFrame>(front));
+    epochs.store(front->epoch, std::memory_order_release);
+}
+
+std::shared_ptr<const WorldFrame> FramePublisher::current() const {
+    return std::atomic_load(&published);
+}
+
+uint64_t FramePublisher::epoch() const {
+    return epochs.load(std::memory_order_acquire);
+}
+
+uint64_t FramePublisher::reallocations() const {
+    return fresh.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,62 @@
+#ifndef WORLD_FRAME_H
+#define WORLD_FRAME_H
+
+#include "npc.h"
+#include "npc_world.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Неизменяемая копия живых NPC мира на конец тика. Читатели (карта,
+// статистика, сохранение) работают только с кадром и не трогают NPCWorld,
+// который в это время меняет следующий тик.
+struct WorldFrame {
+    uint32_t tick = 0;      // число завершенных тиков
+    uint64_t epoch = 0;     // номер публикации, растет на 1
+
+    // Живые NPC в порядке слотов мира
+    std::vector<NPCHandle> handles;
+    std::vector<int32_t> x;
+    std::vector<int32_t> y;
+    std::vector<NPCType> type;
+    std::vector<NameId> names;
+
+    size_t size() const { return handles.size(); }
+
+    // Перезаписывает кадр состоянием мира; буферы переиспользуются
+    void capture(const NPCWorld& world, uint32_t completedTicks);
+
+    // Отвязанные копии для API редактора, как NPCWorld::toNPC
+    std::shared_ptr<NPC> toNPC(size_t i) const;
+    std::vector<std::shared_ptr<NPC>> toNPCs() const;
+};
+
+// Двойной буфер кадров с одним писателем. Писатель заполняет задний кадр
+// (acquire), затем publish() подменяет опубликованный указатель. Читатель
+// берет current() и держит shared_ptr сколько нужно: кадр не изменится,
+// а писатель, видя, что задний кадр еще занят, заведет новый вместо ожидания.
+class FramePublisher {
+public:
+    FramePublisher();
+
+    // Только писатель: задний кадр для заполнения
+    WorldFrame& acquire();
+    // Только писатель: делает заполненный задний кадр текущим
+    void publish();
+
+    // Любой поток, без ожидания писателя
+    std::shared_ptr<const WorldFrame> current() const;
+    uint64_t epoch() const;
+    // Сколько раз задний кадр пришлось выделить заново из-за читателей
+    uint64_t reallocations() const;
+
+private:
+    std::shared_ptr<const WorldFrame> published;  // atomic_load/atomic_store
+    std::shared_ptr<WorldFrame> front;  // тот же кадр, что published, для писателя
+    std::shared_ptr<WorldFrame> back;
+    std::atomic<uint64_t> epochs{0};
+    std::atomic<uint64_t> fresh{0};
+};
+
+#endif